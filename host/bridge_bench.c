@@ -0,0 +1,703 @@
+/**
+    @file
+    @brief   Host benchmark: end-to-end telemetry throughput and latency
+
+    Feeds a synthetic SmartPort stream into the bridge and captures the
+    telemetry datagrams it sends, so the whole forwarding path
+    (telemetry UART reader -> smartPortDownlinkFifo -> telemetry_server_task)
+    is measured.
+
+    By default the udp_serial_bridge daemon is started on the slave side of
+    a pty, bound to the loopback interface and told to send its downlink to
+    a second loopback address, where the benchmark listens. With -t the
+    stream is written to a serial device instead and no daemon is started,
+    e.g. to measure the ESP32 firmware through a USB-serial adapter.
+
+    Every data frame carries its sequence number in the value field. The
+    generator paces the stream at the configured baud rate (10 bits per
+    byte) and records when each frame was written; latency is measured from
+    that point to the arrival of the datagram holding the frame.
+
+    With -u, uplink datagrams are sent to the bridge at the given rate while
+    the stream runs. Each burst then ends with a poll of
+    TELEMETRY_UPLINK_PHYS_ID, so the bridge gets a slot to write uplink data
+    when the burst gap is long enough; the uplink bytes written back to the
+    serial line are counted.
+
+    With -z the daemon compresses the downlink (its -z option) and captured
+    datagrams are decoded by sport_codec.c before frames are matched, so the
+    bytes per datagram show the compressed size.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <poll.h>
+#include <pthread.h>
+#include <termios.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "smartport.h"
+#include "sport_codec.h"
+#include "config.h"
+
+#define BENCH_PHYS_ID           0x98
+#define BENCH_POLL_PHYS_ID      0xA1        // Polled ID that never answers
+#define BENCH_DATA_ID           0x5100
+#define BENCH_SETTLE_TIME_MS    1000        // Wait for stragglers after the last frame is written
+#define BENCH_DATAGRAM_MAX      2048
+#define BENCH_HELLO_PERIOD_MS   1000
+#define BENCH_UPLINK_SIZE       16          // Uplink datagram payload [bytes]
+
+typedef struct {
+    const char *bridgePath;
+    const char *device;         // Serial device, NULL to start the daemon on a pty
+    const char *localAddr;      // Daemon bind address
+    const char *captureAddr;    // Downlink destination = capture socket address
+    uint32_t baudRate;
+    uint32_t frameCount;
+    uint32_t burstFrames;       // Frames written back to back at line rate
+    uint32_t burstGapMs;        // Silence between bursts
+    uint32_t pollsPerFrame;     // Unanswered polls in front of each data frame
+    uint32_t startupMs;
+    bool subscribe;             // Subscribe to downlink instead of relying on broadcast fallback
+    uint32_t uplinkRate;        // Uplink datagrams per second, 0 - no uplink traffic
+    bool compressed;            // Downlink is compressed by sport_codec
+} benchOptions_t;
+
+static benchOptions_t opts = {
+    .bridgePath = NULL,
+    .device = NULL,
+    .localAddr = "127.0.0.1",
+    .captureAddr = "127.0.0.2",
+    .baudRate = TELEMETRY_BAUD_RATE,
+    .frameCount = 20000,
+    .burstFrames = 1,
+    .burstGapMs = 0,
+    .pollsPerFrame = 0,
+    .startupMs = 300,
+    .subscribe = false,
+    .uplinkRate = 0,
+    .compressed = false,
+};
+
+static int serialFd = -1;
+static int captureSock = -1;
+static uint64_t *sendTimeNs;        // Indexed by sequence number, 0 if not written yet
+static uint64_t *latencyNs;         // Indexed by sequence number, 0 if not received
+static atomic_bool generatorDone;
+static uint64_t generatorEndNs;
+
+static struct {
+    uint64_t frames;
+    uint64_t duplicates;
+    uint64_t outOfOrder;
+    uint64_t unknown;           // Valid frames that the generator did not send
+    uint64_t datagrams;
+    uint64_t bytes;
+    uint64_t decodedBytes;      // Compressed downlink: frame bytes decoded
+    uint64_t firstNs;
+    uint64_t lastNs;
+    uint32_t crcErrors;
+    uint32_t framingErrors;
+} rx;
+
+static struct {
+    uint64_t datagrams;
+    uint64_t naks;
+    atomic_uint_fast64_t serialBytes;     // Uplink bytes written by the bridge to the serial line
+} uplink;
+
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+
+static void sleep_until_ns(uint64_t deadline)
+{
+    struct timespec ts;
+    ts.tv_sec = deadline / 1000000000ull;
+    ts.tv_nsec = deadline % 1000000000ull;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+}
+
+
+static uint32_t putStuffed(uint8_t *out, uint8_t byte)
+{
+    if ((byte == SPORT_START_BYTE) || (byte == SPORT_BYTESTUFF))
+    {
+        out[0] = SPORT_BYTESTUFF;
+        out[1] = byte ^ SPORT_STUFF_MASK;
+        return 2;
+    }
+    out[0] = byte;
+    return 1;
+}
+
+
+/**
+    @brief Build a data frame carrying a sequence number
+    @param[out] out Frame buffer, at least SPORT_MAX_RAW_FRAME_SIZE bytes
+    @param[in]  seq Sequence number
+    @return Frame length
+*/
+static uint32_t buildFrame(uint8_t *out, uint32_t seq)
+{
+    uint8_t payload[SPORT_PAYLOAD_SIZE];
+    uint32_t crc = 0;
+    uint32_t len = 0;
+    uint32_t i;
+
+    payload[0] = 0x10;
+    payload[1] = BENCH_DATA_ID & 0xFF;
+    payload[2] = BENCH_DATA_ID >> 8;
+    payload[3] = seq & 0xFF;
+    payload[4] = (seq >> 8) & 0xFF;
+    payload[5] = (seq >> 16) & 0xFF;
+    payload[6] = seq >> 24;
+    for (i = 0; i < SPORT_PAYLOAD_SIZE - 1; i++)
+    {
+        crc += payload[i];
+        crc += crc >> 8;
+        crc &= 0xFF;
+    }
+    payload[SPORT_PAYLOAD_SIZE - 1] = 0xFF - crc;
+
+    out[len++] = SPORT_START_BYTE;
+    out[len++] = BENCH_PHYS_ID;
+    for (i = 0; i < SPORT_PAYLOAD_SIZE; i++)
+        len += putStuffed(&out[len], payload[i]);
+    return len;
+}
+
+
+static void *generator_thread(void *arg)
+{
+    uint8_t buffer[64 * SPORT_MAX_RAW_FRAME_SIZE];
+    uint64_t byteTimeNs = 10000000000ull / opts.baudRate;
+    uint64_t deadline = now_ns();
+    uint32_t seq = 0;
+    (void)arg;
+
+    while (seq < opts.frameCount)
+    {
+        uint32_t burstEnd = seq + opts.burstFrames;
+        if (burstEnd > opts.frameCount)
+            burstEnd = opts.frameCount;
+
+        while (seq < burstEnd)
+        {
+            uint32_t len = 0;
+            uint32_t i;
+            for (i = 0; i < opts.pollsPerFrame; i++)
+            {
+                buffer[len++] = SPORT_START_BYTE;
+                buffer[len++] = BENCH_POLL_PHYS_ID;
+            }
+            len += buildFrame(&buffer[len], seq);
+            if (opts.uplinkRate && (seq + 1 == burstEnd))
+            {
+                // Unanswered poll at the end of burst is the uplink slot
+                buffer[len++] = SPORT_START_BYTE;
+                buffer[len++] = TELEMETRY_UPLINK_PHYS_ID;
+            }
+
+            // Write each frame when the line would have finished sending it
+            deadline += len * byteTimeNs;
+            sleep_until_ns(deadline);
+            __atomic_store_n(&sendTimeNs[seq], now_ns(), __ATOMIC_RELEASE);
+            if (write(serialFd, buffer, len) != (ssize_t)len)
+            {
+                perror("write");
+                sendTimeNs[seq] = 0;
+                break;
+            }
+            seq++;
+        }
+        if (opts.burstGapMs)
+            deadline += opts.burstGapMs * 1000000ull;
+    }
+    generatorEndNs = now_ns();
+    generatorDone = true;
+    return NULL;
+}
+
+
+static void handleFrame(const uint8_t *payload, uint64_t rxTime)
+{
+    static uint32_t nextSeq;
+    uint32_t seq = payload[3] | (payload[4] << 8) | (payload[5] << 16) | ((uint32_t)payload[6] << 24);
+    uint64_t txTime;
+
+    if ((seq >= opts.frameCount) || ((txTime = __atomic_load_n(&sendTimeNs[seq], __ATOMIC_ACQUIRE)) == 0))
+    {
+        rx.unknown++;
+        return;
+    }
+    if (latencyNs[seq])
+    {
+        rx.duplicates++;
+        return;
+    }
+    if (seq < nextSeq)
+        rx.outOfOrder++;
+    nextSeq = seq + 1;
+    latencyNs[seq] = (rxTime > txTime) ? rxTime - txTime : 1;
+    rx.frames++;
+}
+
+
+/**
+    @brief Send subscription hello from the capture socket, so downlink is unicast to it
+*/
+static void sendHello(void)
+{
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(TELEMETRY_PORT);
+    inet_pton(AF_INET, opts.localAddr, &addr.sin_addr);
+    sendto(captureSock, "HELO", 4, 0, (struct sockaddr *)&addr, sizeof(addr));
+}
+
+
+static void *capture_thread(void *arg)
+{
+    static sportDecoder_t decoder;
+    static sportCodecDecoder_t codecDecoder;
+    static uint8_t frames[BENCH_DATAGRAM_MAX * SPORT_MAX_RAW_FRAME_SIZE];
+    uint8_t datagram[BENCH_DATAGRAM_MAX];
+    uint64_t quietSince = 0;
+    uint64_t lastHello = now_ns();
+    (void)arg;
+
+    sportDecoder_Init(&decoder);
+    sportCodecDecoder_Init(&codecDecoder);
+    for (;;)
+    {
+        ssize_t len = recv(captureSock, datagram, sizeof(datagram), 0);
+        uint64_t rxTime = now_ns();
+        ssize_t i;
+
+        if (opts.subscribe && (rxTime - lastHello >= BENCH_HELLO_PERIOD_MS * 1000000ull))
+        {
+            sendHello();
+            lastHello = rxTime;
+        }
+
+        if (len < 0)
+        {
+            if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+            {
+                perror("recv");
+                break;
+            }
+            if (!generatorDone)
+                continue;
+            if (rx.frames == opts.frameCount)
+                break;
+            if (quietSince == 0)
+                quietSince = rxTime;
+            else if (rxTime - quietSince >= BENCH_SETTLE_TIME_MS * 1000000ull)
+                break;
+            continue;
+        }
+        quietSince = 0;
+        if (rx.datagrams == 0)
+            rx.firstNs = rxTime;
+        rx.lastNs = rxTime;
+        rx.datagrams++;
+        rx.bytes += len;
+
+        const uint8_t *data = datagram;
+        if (opts.compressed)
+        {
+            uint32_t decodedLen;
+            sportCodecDecoder_Decode(&codecDecoder, datagram, len, frames, sizeof(frames), &decodedLen);
+            data = frames;
+            len = decodedLen;
+            rx.decodedBytes += decodedLen;
+        }
+        for (i = 0; i < len; i++)
+        {
+            if (sportDecoder_PutByte(&decoder, data[i]) == SportDecoder_Frame)
+                handleFrame(decoder.payload, rxTime);
+        }
+        if (generatorDone && (rx.frames == opts.frameCount))
+            break;
+    }
+    rx.crcErrors = decoder.stats.crcErrors;
+    rx.framingErrors = decoder.stats.framingErrors;
+    return NULL;
+}
+
+
+static void *uplink_thread(void *arg)
+{
+    struct sockaddr_in addr;
+    uint8_t datagram[BENCH_UPLINK_SIZE];
+    uint8_t nak[64];
+    uint64_t periodNs = 1000000000ull / opts.uplinkRate;
+    uint64_t deadline = now_ns();
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    (void)arg;
+
+    if (sock < 0)
+    {
+        perror("socket");
+        return NULL;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(TELEMETRY_PORT);
+    inet_pton(AF_INET, opts.localAddr, &addr.sin_addr);
+    memset(datagram, 0x55, sizeof(datagram));
+
+    while (!generatorDone)
+    {
+        if (sendto(sock, datagram, sizeof(datagram), 0, (struct sockaddr *)&addr, sizeof(addr)) == sizeof(datagram))
+            uplink.datagrams++;
+        while (recv(sock, nak, sizeof(nak), MSG_DONTWAIT) > 0)
+            uplink.naks++;
+        deadline += periodNs;
+        sleep_until_ns(deadline);
+    }
+    close(sock);
+    return NULL;
+}
+
+
+static void *serial_reader_thread(void *arg)
+{
+    uint8_t buffer[256];
+    struct pollfd pfd = { .fd = serialFd, .events = POLLIN };
+    (void)arg;
+
+    while (!generatorDone)
+    {
+        if (poll(&pfd, 1, 100) <= 0)
+            continue;
+        ssize_t len = read(serialFd, buffer, sizeof(buffer));
+        if (len > 0)
+            uplink.serialBytes += len;
+    }
+    return NULL;
+}
+
+
+static int openCaptureSocket(void)
+{
+    struct sockaddr_in addr;
+    struct timeval tv = { .tv_sec = 0, .tv_usec = 100000 };
+    int rcvBuf = 4 * 1024 * 1024;
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if (sock < 0)
+    {
+        perror("socket");
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(TELEMETRY_PORT);
+    if (inet_pton(AF_INET, opts.captureAddr, &addr.sin_addr) != 1)
+    {
+        fprintf(stderr, "Invalid capture address: %s\n", opts.captureAddr);
+        close(sock);
+        return -1;
+    }
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvBuf, sizeof(rcvBuf));
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        perror("bind");
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+
+static int openSerialDevice(const char *device)
+{
+    struct termios tio;
+    int fd = open(device, O_RDWR | O_NOCTTY);
+
+    if (fd < 0)
+    {
+        perror(device);
+        return -1;
+    }
+    if (tcgetattr(fd, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    return fd;
+}
+
+
+/**
+    @brief Open a pty pair and start the bridge daemon on its slave side
+    @return Daemon pid, -1 on error. serialFd is set to the pty master.
+*/
+static pid_t startBridge(void)
+{
+    struct termios tio;
+    char baud[16];
+    const char *slaveName;
+    pid_t pid;
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if ((master < 0) || (grantpt(master) < 0) || (unlockpt(master) < 0))
+    {
+        perror("posix_openpt");
+        return -1;
+    }
+    slaveName = ptsname(master);
+    if (tcgetattr(master, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+        tcsetattr(master, TCSANOW, &tio);
+    }
+    snprintf(baud, sizeof(baud), "%u", opts.baudRate);
+
+    pid = fork();
+    if (pid < 0)
+    {
+        perror("fork");
+        return -1;
+    }
+    if (pid == 0)
+    {
+        close(master);
+        execl(opts.bridgePath, opts.bridgePath, "-t", slaveName, "-B", baud,
+              "-l", opts.localAddr, "-d", opts.captureAddr, opts.compressed ? "-z" : (char *)NULL, (char *)NULL);
+        perror(opts.bridgePath);
+        _exit(127);
+    }
+    serialFd = master;
+    return pid;
+}
+
+
+static int compareU64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+
+static double percentileUs(const uint64_t *sorted, uint64_t count, double p)
+{
+    uint64_t index;
+    if (count == 0)
+        return 0;
+    index = (uint64_t)(p * (count - 1) + 0.5);
+    return sorted[index] / 1000.0;
+}
+
+
+static void report(uint64_t startNs)
+{
+    uint64_t *sorted = malloc(sizeof(uint64_t) * (rx.frames ? rx.frames : 1));
+    uint64_t count = 0;
+    uint64_t written = 0;
+    uint32_t i;
+    double sendSeconds = (generatorEndNs - startNs) / 1e9;
+    double rxSeconds = (rx.lastNs > startNs) ? (rx.lastNs - startNs) / 1e9 : 0;
+
+    for (i = 0; i < opts.frameCount; i++)
+    {
+        if (sendTimeNs[i])
+            written++;
+        if (latencyNs[i])
+            sorted[count++] = latencyNs[i];
+    }
+    qsort(sorted, count, sizeof(uint64_t), compareU64);
+
+    printf("baud %u, burst %u frames, gap %u ms, polls/frame %u\n",
+           opts.baudRate, opts.burstFrames, opts.burstGapMs, opts.pollsPerFrame);
+    printf("sent      %10llu frames in %.3f s (%.0f frames/s)\n",
+           (unsigned long long)written, sendSeconds, sendSeconds > 0 ? written / sendSeconds : 0);
+    printf("received  %10llu frames in %.3f s (%.0f frames/s)\n",
+           (unsigned long long)rx.frames, rxSeconds, rxSeconds > 0 ? rx.frames / rxSeconds : 0);
+    printf("dropped   %10llu frames (%.3f %%)\n",
+           (unsigned long long)(written - rx.frames),
+           written ? 100.0 * (written - rx.frames) / written : 0);
+    printf("datagrams %10llu, %.1f frames/datagram, %.0f bytes/datagram\n",
+           (unsigned long long)rx.datagrams,
+           rx.datagrams ? (double)rx.frames / rx.datagrams : 0,
+           rx.datagrams ? (double)rx.bytes / rx.datagrams : 0);
+    if (opts.compressed)
+        printf("codec     %.1f bytes/datagram decoded, ratio %.2fx\n",
+               rx.datagrams ? (double)rx.decodedBytes / rx.datagrams : 0,
+               rx.bytes ? (double)rx.decodedBytes / rx.bytes : 0);
+    printf("errors    duplicates %llu, out of order %llu, unknown %llu, crc %u, framing %u\n",
+           (unsigned long long)rx.duplicates, (unsigned long long)rx.outOfOrder,
+           (unsigned long long)rx.unknown, rx.crcErrors, rx.framingErrors);
+    printf("latency   p50 %.0f us, p99 %.0f us, p999 %.0f us, max %.0f us\n",
+           percentileUs(sorted, count, 0.50), percentileUs(sorted, count, 0.99),
+           percentileUs(sorted, count, 0.999), count ? sorted[count - 1] / 1000.0 : 0);
+    if (opts.uplinkRate)
+        printf("uplink    %llu datagrams sent, %llu NAK, %llu bytes written to serial line (%llu datagrams)\n",
+               (unsigned long long)uplink.datagrams, (unsigned long long)uplink.naks,
+               (unsigned long long)uplink.serialBytes, (unsigned long long)uplink.serialBytes / BENCH_UPLINK_SIZE);
+    free(sorted);
+}
+
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  -b <path>     bridge daemon (default udp_serial_bridge next to this program)\n"
+        "  -t <device>   write to a serial device instead of starting the daemon\n"
+        "  -l <addr>     daemon bind address (default %s)\n"
+        "  -d <addr>     capture address, daemon downlink destination (default %s)\n"
+        "  -B <baud>     stream baud rate (default %u)\n"
+        "  -n <frames>   number of data frames (default %u)\n"
+        "  -s <frames>   burst size (default %u)\n"
+        "  -g <ms>       gap between bursts (default %u)\n"
+        "  -p <polls>    unanswered polls before each data frame (default %u)\n"
+        "  -w <ms>       daemon startup wait (default %u)\n"
+        "  -S            subscribe to downlink with hello datagrams sent to the -l address\n"
+        "  -u <rate>     send uplink datagrams at this rate [1/s] during the run\n"
+        "  -z            compressed downlink, the daemon is started with -z\n",
+        name, opts.localAddr, opts.captureAddr, opts.baudRate, opts.frameCount,
+        opts.burstFrames, opts.burstGapMs, opts.pollsPerFrame, opts.startupMs);
+}
+
+
+static char *defaultBridgePath(void)
+{
+    static char path[PATH_MAX];
+    ssize_t len = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    char *slash;
+
+    if (len <= 0)
+        return "udp_serial_bridge";
+    path[len] = 0;
+    slash = strrchr(path, '/');
+    if (!slash || (size_t)(slash - path) + sizeof("/udp_serial_bridge") > sizeof(path))
+        return "udp_serial_bridge";
+    strcpy(slash, "/udp_serial_bridge");
+    return path;
+}
+
+
+int main(int argc, char *argv[])
+{
+    pthread_t generator;
+    pthread_t capture;
+    pthread_t uplinkSender;
+    pthread_t serialReader;
+    pid_t bridgePid = -1;
+    uint64_t startNs;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "b:t:l:d:B:n:s:g:p:w:Su:zh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'b': opts.bridgePath = optarg; break;
+            case 't': opts.device = optarg; break;
+            case 'l': opts.localAddr = optarg; break;
+            case 'd': opts.captureAddr = optarg; break;
+            case 'B': opts.baudRate = strtoul(optarg, NULL, 0); break;
+            case 'n': opts.frameCount = strtoul(optarg, NULL, 0); break;
+            case 's': opts.burstFrames = strtoul(optarg, NULL, 0); break;
+            case 'g': opts.burstGapMs = strtoul(optarg, NULL, 0); break;
+            case 'p': opts.pollsPerFrame = strtoul(optarg, NULL, 0); break;
+            case 'w': opts.startupMs = strtoul(optarg, NULL, 0); break;
+            case 'S': opts.subscribe = true; break;
+            case 'u': opts.uplinkRate = strtoul(optarg, NULL, 0); break;
+            case 'z': opts.compressed = true; break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if ((opts.baudRate == 0) || (opts.frameCount == 0) || (opts.burstFrames == 0))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if (!opts.bridgePath)
+        opts.bridgePath = defaultBridgePath();
+
+    sendTimeNs = calloc(opts.frameCount, sizeof(uint64_t));
+    latencyNs = calloc(opts.frameCount, sizeof(uint64_t));
+    if (!sendTimeNs || !latencyNs)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    captureSock = openCaptureSocket();
+    if (captureSock < 0)
+        return 1;
+    if (opts.device)
+    {
+        serialFd = openSerialDevice(opts.device);
+        if (serialFd < 0)
+            return 1;
+    }
+    else
+    {
+        bridgePid = startBridge();
+        if (bridgePid < 0)
+            return 1;
+    }
+    usleep(opts.startupMs * 1000);
+    if (opts.subscribe)
+    {
+        sendHello();
+        usleep(50000);
+    }
+
+    startNs = now_ns();
+    pthread_create(&capture, NULL, capture_thread, NULL);
+    pthread_create(&generator, NULL, generator_thread, NULL);
+    if (opts.uplinkRate)
+    {
+        pthread_create(&uplinkSender, NULL, uplink_thread, NULL);
+        pthread_create(&serialReader, NULL, serial_reader_thread, NULL);
+    }
+    pthread_join(generator, NULL);
+    if (opts.uplinkRate)
+    {
+        pthread_join(uplinkSender, NULL);
+        pthread_join(serialReader, NULL);
+    }
+    pthread_join(capture, NULL);
+
+    if (bridgePid > 0)
+    {
+        kill(bridgePid, SIGTERM);
+        waitpid(bridgePid, NULL, 0);
+    }
+    report(startNs);
+    return (rx.frames == opts.frameCount) ? 0 : 2;
+}
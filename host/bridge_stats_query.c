@@ -0,0 +1,226 @@
+/**
+    @file
+    @brief   Query bridge runtime counters over UDP
+
+    Sends a stats query to STATS_PORT of the bridge (ESP32 firmware or
+    udp_serial_bridge daemon) and prints the counters. With -w the query
+    is repeated and per-second rates are printed next to the totals.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "bridge_stats.h"
+#include "config.h"
+
+#define QUERY_TIMEOUT_MS        500
+
+static const char *counterNames[] = {
+    "telemetry_uart_rx_bytes",
+    "telemetry_uart_overflows",
+    "telemetry_uart_breaks",
+    "telemetry_uart_frame_errors",
+    "sport_frames",
+    "sport_polls",
+    "sport_crc_errors",
+    "sport_framing_errors",
+    "downlink_frames_queued",
+    "downlink_frames_dropped",
+    "downlink_fifo_size",
+    "downlink_fifo_high_water",
+    "downlink_datagrams",
+    "downlink_bytes",
+    "downlink_send_errors",
+    "uplink_datagrams",
+    "uplink_bytes",
+    "aat_telemetry_bytes",
+    "aat_telemetry_skipped_bytes",
+    "aat_telemetry_dropped_bytes",
+    "config_downlink_datagrams",
+    "config_downlink_bytes",
+    "config_downlink_send_errors",
+    "config_downlink_dropped_bytes",
+    "config_uplink_datagrams",
+    "config_uplink_bytes",
+    "config_uplink_dropped_bytes",
+    "config_mode_entries",
+    "config_mode_time_ms",
+    "stats_requests",
+    "subscribers",
+    "subscriber_joins",
+    "subscriber_expiries",
+    "subscribers_rejected",
+    "uplink_datagrams_queued",
+    "uplink_datagrams_rejected",
+    "uplink_fifo_high_water",
+    "uplink_uart_datagrams",
+    "uplink_uart_bytes",
+    "uplink_unpaced_writes",
+    "config_downlink_fifo_dropped_bytes",
+    "telemetry_timeouts",
+    "aat_uart_rx_bytes",
+    "aat_uart_overflows",
+    "aat_uart_breaks",
+    "aat_uart_frame_errors",
+    "buffer_pool_exhausted",
+    "buffer_pool_high_water",
+    "telemetry_uart_baud_rate",
+    "aat_uart_baud_rate",
+    "baud_rate_changes",
+    "autobaud_locks",
+    "boot_nvs_ready_ms",
+    "boot_uarts_ready_ms",
+    "boot_wifi_started_ms",
+    "boot_socket_bound_ms",
+    "boot_first_uart_data_ms",
+    "boot_first_datagram_ms",
+    "downlink_overflow_policy",
+    "downlink_evicted_bytes",
+    "downlink_evicted_frames",
+    "downlink_codec_raw_bytes",
+    "downlink_codec_bytes",
+    "downlink_codec_keys",
+    "downlink_codec_literals",
+};
+_Static_assert(sizeof(counterNames) / sizeof(counterNames[0]) == BridgeStat_Count, "counterNames must match bridgeStat_t");
+
+typedef struct {
+    uint32_t uptimeMs;
+    uint32_t count;
+    uint32_t values[256];
+} statsSnapshot_t;
+
+
+static uint32_t getU32(const uint8_t *src)
+{
+    return ((uint32_t)src[0] << 24) | ((uint32_t)src[1] << 16) | ((uint32_t)src[2] << 8) | src[3];
+}
+
+
+static int query(int sock, const struct sockaddr_in *addr, statsSnapshot_t *snapshot)
+{
+    uint8_t response[BRIDGE_STATS_HEADER_SIZE + 4 * 256];
+    ssize_t len;
+    uint32_t i;
+
+    if (sendto(sock, BRIDGE_STATS_MAGIC, BRIDGE_STATS_MAGIC_SIZE, 0, (const struct sockaddr *)addr, sizeof(*addr)) < 0)
+    {
+        perror("sendto");
+        return -1;
+    }
+    do
+    {
+        len = recv(sock, response, sizeof(response), 0);
+        if (len < 0)
+        {
+            fprintf(stderr, "No response\n");
+            return -1;
+        }
+    } while ((len < BRIDGE_STATS_HEADER_SIZE) || (memcmp(response, BRIDGE_STATS_MAGIC, BRIDGE_STATS_MAGIC_SIZE) != 0));
+
+    if (response[4] != BRIDGE_STATS_VERSION)
+        fprintf(stderr, "Warning: response version %u, expected %u\n", response[4], BRIDGE_STATS_VERSION);
+    snapshot->uptimeMs = getU32(&response[8]);
+    snapshot->count = response[5];
+    if (snapshot->count > (len - BRIDGE_STATS_HEADER_SIZE) / 4)
+        snapshot->count = (len - BRIDGE_STATS_HEADER_SIZE) / 4;
+    for (i = 0; i < snapshot->count; i++)
+        snapshot->values[i] = getU32(&response[BRIDGE_STATS_HEADER_SIZE + i * 4]);
+    return 0;
+}
+
+
+static void print(const statsSnapshot_t *snapshot, const statsSnapshot_t *previous)
+{
+    double seconds = previous ? (snapshot->uptimeMs - previous->uptimeMs) / 1000.0 : 0;
+    uint32_t i;
+
+    printf("uptime %.3f s\n", snapshot->uptimeMs / 1000.0);
+    for (i = 0; i < snapshot->count; i++)
+    {
+        char unknownName[32];
+        const char *name = counterNames[i < BridgeStat_Count ? i : 0];
+        if (i >= BridgeStat_Count)
+        {
+            snprintf(unknownName, sizeof(unknownName), "counter_%u", i);
+            name = unknownName;
+        }
+        if (previous && (seconds > 0) && (i < previous->count))
+            printf("  %-32s %12u %12.1f/s\n", name, snapshot->values[i],
+                   (uint32_t)(snapshot->values[i] - previous->values[i]) / seconds);
+        else
+            printf("  %-32s %12u\n", name, snapshot->values[i]);
+    }
+    fflush(stdout);
+}
+
+
+int main(int argc, char *argv[])
+{
+    struct sockaddr_in addr;
+    struct timeval tv = { .tv_sec = 0, .tv_usec = QUERY_TIMEOUT_MS * 1000 };
+    statsSnapshot_t snapshots[2];
+    uint32_t port = STATS_PORT;
+    uint32_t watchSeconds = 0;
+    int current = 0;
+    int sock;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "p:w:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'p':
+                port = strtoul(optarg, NULL, 0);
+                break;
+            case 'w':
+                watchSeconds = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-p <port>] [-w <interval s>] <bridge address>\n", argv[0]);
+                return 1;
+        }
+    }
+    if (optind >= argc)
+    {
+        fprintf(stderr, "Usage: %s [-p <port>] [-w <interval s>] <bridge address>\n", argv[0]);
+        return 1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, argv[optind], &addr.sin_addr) != 1)
+    {
+        fprintf(stderr, "Invalid address: %s\n", argv[optind]);
+        return 1;
+    }
+    sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0)
+    {
+        perror("socket");
+        return 1;
+    }
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    if (query(sock, &addr, &snapshots[current]) < 0)
+        return 1;
+    print(&snapshots[current], NULL);
+    while (watchSeconds)
+    {
+        sleep(watchSeconds);
+        current ^= 1;
+        if (query(sock, &addr, &snapshots[current]) < 0)
+            return 1;
+        print(&snapshots[current], &snapshots[current ^ 1]);
+    }
+    return 0;
+}
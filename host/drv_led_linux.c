@@ -0,0 +1,48 @@
+/**
+    @file
+    @brief   LED driver, Linux implementation
+             There are no LEDs, state changes are printed at debug log level
+*/
+
+#include "hal.h"
+#include "drv_led.h"
+
+//------------ Definitions ----------//
+
+//------------ Variables ------------//
+
+static LedState ledStates[LedCount];
+
+//------------ Externals ------------//
+
+//------------ Prototypes -----------//
+
+//--------- Implementation ----------//
+
+
+/**
+    @brief  Init LED driver
+    @param  None
+    @return None
+*/
+void drvLed_Init(void)
+{
+}
+
+
+/**
+    @brief  Set LED state
+    @param[in]  led Led to set
+    @param[in]  state New state, 1 = enable, 0 = disable
+    @return None
+*/
+void drvLed_Set(Leds led, LedState state)
+{
+    if (led >= LedCount)
+        return;
+    if (ledStates[led] != state)
+    {
+        ledStates[led] = state;
+        HAL_LOGD("led", "LED %d %s", led, (state) ? "on" : "off");
+    }
+}
@@ -0,0 +1,558 @@
+/**
+    @file
+    @brief   Platform abstraction layer, Linux implementation
+
+    Tasks are POSIX threads. Each UART is a serial device (real port or pty)
+    in raw mode, waited for with epoll. Line idle is detected when no data
+    arrives within rxTimeout symbol times after last received data.
+
+    Bridge tasks are shared with the firmware and block in their own waits
+    (hal_UartWaitEvent(), select(), hal_SignalWait()) as FreeRTOS tasks do,
+    so each of them keeps its thread instead of running from one event loop.
+    UART writes are serialized per port, as the ESP-IDF driver does.
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <termios.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+
+#include "hal.h"
+#include "hal_linux.h"
+
+//------------ Definitions ----------//
+
+typedef struct {
+    const char *device;
+    uint32_t baudRate;              // Overrides configured baud rate if not zero
+    int fd;
+    int epollFd;
+    uint32_t currentBaudRate;       // Set by hal_UartOpen() and hal_UartSetBaudRate()
+    uint8_t rxTimeout;              // [UART symbols]
+    int idleTimeoutMs;
+    bool isIdlePending;             // Data was received, line idle is not reported yet
+    pthread_mutex_t writeMutex;     // Writes of several tasks are not interleaved
+} halUart_t;
+
+typedef struct {
+    hal_TaskFunction_t function;
+    void *arg;
+} halTaskStart_t;
+
+struct hal_Signal_s {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;            // Uses CLOCK_MONOTONIC, as hal_GetTimeUs()
+    bool isSet;
+};
+
+struct hal_Mutex_s {
+    pthread_mutex_t mutex;
+};
+
+//------------ Variables ------------//
+
+static halUart_t uarts[HAL_LINUX_MAX_UARTS] = {
+    [0 ... HAL_LINUX_MAX_UARTS - 1] = { .fd = -1, .epollFd = -1, .writeMutex = PTHREAD_MUTEX_INITIALIZER },
+};
+static hal_LogLevel_t logLevel = HalLog_Warning;
+static pthread_mutex_t logMutex = PTHREAD_MUTEX_INITIALIZER;
+
+//------------ Externals ------------//
+
+//------------ Prototypes -----------//
+
+//--------- Implementation ----------//
+
+
+/**
+    @brief  Get monotonic time
+    @return Time since arbitrary point [us]
+*/
+int64_t hal_GetTimeUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+/**
+    @brief  Block calling thread
+    @param[in]  ms Delay [ms]
+    @return None
+*/
+void hal_DelayMs(uint32_t ms)
+{
+    struct timespec ts = {
+        .tv_sec = ms / 1000,
+        .tv_nsec = (long)(ms % 1000) * 1000000,
+    };
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR) {}
+}
+
+
+static void *hal_TaskEntry(void *arg)
+{
+    halTaskStart_t start = *(halTaskStart_t *)arg;
+    free(arg);
+    start.function(start.arg);
+    return NULL;
+}
+
+
+/**
+    @brief  Create task as a detached thread
+            Stack size and priority are not used, threads use system defaults
+    @param[in]  function Task function
+    @param[in]  name Task name
+    @param[in]  stackSize Not used
+    @param[in]  arg Argument passed to the task function
+    @param[in]  priority Not used
+    @return True if task is created
+*/
+bool hal_TaskCreate(hal_TaskFunction_t function, const char *name, uint32_t stackSize, void *arg, uint32_t priority)
+{
+    pthread_t thread;
+    halTaskStart_t *start = malloc(sizeof(*start));
+    (void)stackSize;
+    (void)priority;
+    if (!start)
+        return false;
+    start->function = function;
+    start->arg = arg;
+    if (pthread_create(&thread, NULL, hal_TaskEntry, start) != 0)
+    {
+        free(start);
+        return false;
+    }
+    pthread_setname_np(thread, name);
+    pthread_detach(thread);
+    return true;
+}
+
+
+/**
+    @brief  Create binary signal
+            Signal is set by hal_SignalGive() and cleared by hal_SignalWait() that
+            returns it. Several gives before a wait are seen as one.
+    @return Signal, NULL on error
+*/
+hal_Signal_t hal_SignalCreate(void)
+{
+    pthread_condattr_t attr;
+    hal_Signal_t signal = malloc(sizeof(*signal));
+    if (!signal)
+        return NULL;
+    pthread_mutex_init(&signal->mutex, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&signal->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    signal->isSet = false;
+    return signal;
+}
+
+
+/**
+    @brief  Set signal and wake thread waiting for it
+    @param[in]  signal Signal
+    @return None
+*/
+void hal_SignalGive(hal_Signal_t signal)
+{
+    pthread_mutex_lock(&signal->mutex);
+    signal->isSet = true;
+    pthread_cond_signal(&signal->cond);
+    pthread_mutex_unlock(&signal->mutex);
+}
+
+
+/**
+    @brief  Wait until signal is set and clear it
+    @param[in]  signal Signal
+    @param[in]  timeoutMs Timeout [ms] or HAL_WAIT_FOREVER
+    @return True if signal was set, false on timeout
+*/
+bool hal_SignalWait(hal_Signal_t signal, uint32_t timeoutMs)
+{
+    struct timespec deadline;
+    bool isSet;
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeoutMs / 1000;
+    deadline.tv_nsec += (long)(timeoutMs % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&signal->mutex);
+    while (!signal->isSet)
+    {
+        if (timeoutMs == HAL_WAIT_FOREVER)
+            pthread_cond_wait(&signal->cond, &signal->mutex);
+        else if (pthread_cond_timedwait(&signal->cond, &signal->mutex, &deadline) == ETIMEDOUT)
+            break;
+    }
+    isSet = signal->isSet;
+    signal->isSet = false;
+    pthread_mutex_unlock(&signal->mutex);
+    return isSet;
+}
+
+
+/**
+    @brief  Create mutex
+    @return Mutex, NULL on error
+*/
+hal_Mutex_t hal_MutexCreate(void)
+{
+    hal_Mutex_t mutex = malloc(sizeof(*mutex));
+    if (mutex)
+        pthread_mutex_init(&mutex->mutex, NULL);
+    return mutex;
+}
+
+
+/**
+    @brief  Lock mutex, block until it is available
+    @param[in]  mutex Mutex
+    @return None
+*/
+void hal_MutexLock(hal_Mutex_t mutex)
+{
+    pthread_mutex_lock(&mutex->mutex);
+}
+
+
+/**
+    @brief  Unlock mutex
+    @param[in]  mutex Mutex
+    @return None
+*/
+void hal_MutexUnlock(hal_Mutex_t mutex)
+{
+    pthread_mutex_unlock(&mutex->mutex);
+}
+
+
+static speed_t hal_BaudToSpeed(uint32_t baudRate)
+{
+    switch (baudRate)
+    {
+        case 9600:      return B9600;
+        case 19200:     return B19200;
+        case 38400:     return B38400;
+        case 57600:     return B57600;
+        case 115200:    return B115200;
+        case 230400:    return B230400;
+        case 460800:    return B460800;
+        case 921600:    return B921600;
+        case 1000000:   return B1000000;
+        case 2000000:   return B2000000;
+        default:        return B0;
+    }
+}
+
+
+/**
+    @brief  Convert RX timeout to line idle time at current baud rate
+    @param[in,out]  u UART
+    @return None
+*/
+static void hal_UartSetIdleTimeout(halUart_t *u)
+{
+    // 10 bits per symbol, epoll resolution is 1 ms
+    u->idleTimeoutMs = (int)((u->rxTimeout * 10u * 1000u + u->currentBaudRate - 1) / u->currentBaudRate);
+    if (u->idleTimeoutMs < 1)
+        u->idleTimeoutMs = 1;
+}
+
+
+/**
+    @brief  Assign serial device to UART number
+            Must be called before hal_UartOpen()
+    @param[in]  port UART number
+    @param[in]  device Device path, e.g. /dev/ttyUSB0 or pty slave
+    @param[in]  baudRate Baud rate, 0 to use configured one
+    @return None
+*/
+void hal_UartSetDevice(int port, const char *device, uint32_t baudRate)
+{
+    if ((port < 0) || (port >= HAL_LINUX_MAX_UARTS))
+        return;
+    uarts[port].device = device;
+    uarts[port].baudRate = baudRate;
+}
+
+
+/**
+    @brief  Open serial device assigned to UART number in raw mode
+    @param[in]  config UART configuration. Pins are not used
+    @return True if UART is ready
+*/
+bool hal_UartOpen(const hal_UartConfig_t *config)
+{
+    struct termios tio;
+    struct epoll_event ev;
+    halUart_t *u;
+    uint32_t baudRate;
+
+    if ((config->port < 0) || (config->port >= HAL_LINUX_MAX_UARTS))
+        return false;
+    u = &uarts[config->port];
+    if (!u->device)
+        return false;
+
+    u->fd = open(u->device, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (u->fd < 0)
+    {
+        HAL_LOGE("hal", "Unable to open %s: %s", u->device, strerror(errno));
+        return false;
+    }
+
+    baudRate = (u->baudRate) ? u->baudRate : config->baudRate;
+    if (tcgetattr(u->fd, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+        tio.c_cflag |= CLOCAL | CREAD;
+        tio.c_cc[VMIN] = 0;
+        tio.c_cc[VTIME] = 0;
+        if (hal_BaudToSpeed(baudRate) != B0)
+            cfsetspeed(&tio, hal_BaudToSpeed(baudRate));
+        else
+            HAL_LOGW("hal", "%s: unsupported baud rate %u", u->device, baudRate);
+        if (tcsetattr(u->fd, TCSANOW, &tio) < 0)
+            HAL_LOGW("hal", "%s: unable to set attributes: %s", u->device, strerror(errno));
+    }
+
+    u->rxTimeout = config->rxTimeout;
+    u->currentBaudRate = baudRate;
+    hal_UartSetIdleTimeout(u);
+
+    u->epollFd = epoll_create1(0);
+    ev.events = EPOLLIN;
+    ev.data.fd = u->fd;
+    if ((u->epollFd < 0) || (epoll_ctl(u->epollFd, EPOLL_CTL_ADD, u->fd, &ev) < 0))
+    {
+        HAL_LOGE("hal", "%s: epoll setup failed: %s", u->device, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+
+/**
+    @brief  Wait for UART event
+            Data event is reported when data arrives, then once more with lineIdle
+            flag when no data arrives during idle timeout
+    @param[in]  port UART number
+    @param[out]  event Received event
+    @param[in]  timeoutMs Timeout [ms] or HAL_WAIT_FOREVER
+    @return True if event is received, false on timeout
+*/
+bool hal_UartWaitEvent(int port, hal_UartEvent_t *event, uint32_t timeoutMs)
+{
+    struct epoll_event ev;
+    halUart_t *u = &uarts[port];
+    int timeout = (timeoutMs == HAL_WAIT_FOREVER) ? -1 : (int)timeoutMs;
+    int n;
+
+    if (u->epollFd < 0)
+    {
+        hal_DelayMs((timeoutMs == HAL_WAIT_FOREVER) ? 1000 : timeoutMs);
+        return false;
+    }
+    if (u->isIdlePending && ((timeout < 0) || (timeout > u->idleTimeoutMs)))
+        timeout = u->idleTimeoutMs;
+
+    n = epoll_wait(u->epollFd, &ev, 1, timeout);
+    if (n > 0)
+    {
+        if ((ev.events & (EPOLLHUP | EPOLLERR)) && (hal_UartAvailable(port) == 0))
+        {
+            // pty master is closed - nothing to read until it is reopened
+            hal_DelayMs(10);
+            return false;
+        }
+        u->isIdlePending = true;
+        event->type = HalUartEvent_Data;
+        event->lineIdle = false;
+        return true;
+    }
+    if ((n == 0) && u->isIdlePending)
+    {
+        u->isIdlePending = false;
+        event->type = HalUartEvent_Data;
+        event->lineIdle = true;
+        return true;
+    }
+    return false;
+}
+
+
+/**
+    @brief  Get number of received bytes avaliable for reading
+    @param[in]  port UART number
+    @return Number of bytes
+*/
+int hal_UartAvailable(int port)
+{
+    int availCnt = 0;
+    if ((port < 0) || (port >= HAL_LINUX_MAX_UARTS) || (uarts[port].fd < 0))
+        return 0;
+    if (ioctl(uarts[port].fd, FIONREAD, &availCnt) < 0)
+        return 0;
+    return availCnt;
+}
+
+
+/**
+    @brief  Read received data without blocking
+    @param[in]  port UART number
+    @param[out]  data Buffer for data
+    @param[in]  len Max number of bytes to read
+    @return Number of bytes read, negative on error
+*/
+int hal_UartRead(int port, void *data, uint32_t len)
+{
+    ssize_t n;
+    if ((port < 0) || (port >= HAL_LINUX_MAX_UARTS) || (uarts[port].fd < 0))
+        return -1;
+    n = read(uarts[port].fd, data, len);
+    if ((n < 0) && ((errno == EAGAIN) || (errno == EINTR)))
+        return 0;
+    return (int)n;
+}
+
+
+/**
+    @brief  Write data to serial device, blocks until all data is accepted by the kernel
+            Data of concurrent calls is not interleaved
+    @param[in]  port UART number
+    @param[in]  data Data to send
+    @param[in]  len Number of bytes
+    @return Number of bytes written, negative on error
+*/
+int hal_UartWrite(int port, const void *data, uint32_t len)
+{
+    const uint8_t *ptr = data;
+    uint32_t total = 0;
+    if ((port < 0) || (port >= HAL_LINUX_MAX_UARTS) || (uarts[port].fd < 0))
+        return -1;
+    pthread_mutex_lock(&uarts[port].writeMutex);
+    while (total < len)
+    {
+        ssize_t n = write(uarts[port].fd, ptr + total, len - total);
+        if (n > 0)
+        {
+            total += n;
+        }
+        else if ((n < 0) && (errno == EAGAIN))
+        {
+            struct pollfd pfd = { .fd = uarts[port].fd, .events = POLLOUT };
+            if (poll(&pfd, 1, 100) <= 0)
+                break;
+        }
+        else if (!((n < 0) && (errno == EINTR)))
+        {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&uarts[port].writeMutex);
+    return (int)total;
+}
+
+
+/**
+    @brief  Discard all received data
+    @param[in]  port UART number
+    @return None
+*/
+void hal_UartFlushInput(int port)
+{
+    if ((port < 0) || (port >= HAL_LINUX_MAX_UARTS) || (uarts[port].fd < 0))
+        return;
+    tcflush(uarts[port].fd, TCIFLUSH);
+}
+
+
+/**
+    @brief  Change baud rate of open serial device
+    @param[in]  port UART number
+    @param[in]  baudRate New baud rate, one of termios standard rates
+    @return True if baud rate is set
+*/
+bool hal_UartSetBaudRate(int port, uint32_t baudRate)
+{
+    struct termios tio;
+    halUart_t *u;
+
+    if ((port < 0) || (port >= HAL_LINUX_MAX_UARTS) || (uarts[port].fd < 0))
+        return false;
+    u = &uarts[port];
+    if ((hal_BaudToSpeed(baudRate) == B0) || (tcgetattr(u->fd, &tio) < 0))
+        return false;
+    cfsetspeed(&tio, hal_BaudToSpeed(baudRate));
+    if (tcsetattr(u->fd, TCSANOW, &tio) < 0)
+        return false;
+    u->currentBaudRate = baudRate;
+    hal_UartSetIdleTimeout(u);
+    return true;
+}
+
+
+/**
+    @brief  Get baud rate of open serial device
+    @param[in]  port UART number
+    @return Baud rate, 0 if device is not open
+*/
+uint32_t hal_UartGetBaudRate(int port)
+{
+    if ((port < 0) || (port >= HAL_LINUX_MAX_UARTS) || (uarts[port].fd < 0))
+        return 0;
+    return uarts[port].currentBaudRate;
+}
+
+
+/**
+    @brief  Set max level of messages printed by hal_Log()
+    @param[in]  level Log level
+    @return None
+*/
+void hal_SetLogLevel(hal_LogLevel_t level)
+{
+    logLevel = level;
+}
+
+
+/**
+    @brief  Print log message to stderr
+    @param[in]  level Message level
+    @param[in]  tag Message source
+    @param[in]  format printf-like format
+    @return None
+*/
+void hal_Log(hal_LogLevel_t level, const char *tag, const char *format, ...)
+{
+    static const char levelChars[] = "EWID";
+    va_list args;
+    if (level > logLevel)
+        return;
+    pthread_mutex_lock(&logMutex);
+    fprintf(stderr, "%c (%lld) %s: ", levelChars[level], (long long)(hal_GetTimeUs() / 1000), tag);
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+    pthread_mutex_unlock(&logMutex);
+}
@@ -0,0 +1,26 @@
+/**
+    @file
+    @brief   Platform abstraction layer, Linux specific functions
+*/
+
+#ifndef __HAL_LINUX_H__
+#define __HAL_LINUX_H__
+
+#include <stdint.h>
+#include "hal.h"
+
+#define HAL_LINUX_MAX_UARTS         4
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    void hal_UartSetDevice(int port, const char *device, uint32_t baudRate);
+    void hal_SetLogLevel(hal_LogLevel_t level);
+
+#ifdef __cplusplus
+}   // extern "C"
+#endif
+
+#endif // __HAL_LINUX_H__
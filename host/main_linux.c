@@ -0,0 +1,119 @@
+/**
+    @file
+    @brief   Linux daemon entry point
+
+    Runs the same bridge logic as the ESP32 firmware, using serial devices
+    instead of ESP32 UARTs and any network interface instead of the softAP.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "hal.h"
+#include "hal_linux.h"
+#include "bridge.h"
+#include "boot_timing.h"
+#include "config.h"
+
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+        "Usage: %s -t <device> [options]\n"
+        "  -t <device>   telemetry serial device (receiver / TX module SmartPort)\n"
+        "  -a <device>   AAT serial device\n"
+        "  -B <baud>     telemetry baud rate (default %u)\n"
+        "  -A <baud>     AAT baud rate (default %u)\n"
+        "  -l <addr>     local address of UDP sockets (default any)\n"
+        "  -d <addr>     telemetry downlink destination without subscribers (default 255.255.255.255)\n"
+        "  -m <group>    send downlink to multicast group instead of unicast to each subscriber\n"
+        "  -z            compress downlink datagrams, decode them with sport_decode\n"
+        "  -v            verbose, repeat for debug output\n",
+        name, TELEMETRY_BAUD_RATE, AAT_BAUD_RATE);
+}
+
+
+static bool parseAddr(const char *str, uint32_t *addr)
+{
+    struct in_addr in;
+    if (inet_pton(AF_INET, str, &in) != 1)
+        return false;
+    *addr = in.s_addr;
+    return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+    const char *telemetryDevice = NULL;
+    const char *aatDevice = NULL;
+    uint32_t telemetryBaud = 0;
+    uint32_t aatBaud = 0;
+    int logLevel = HalLog_Warning;
+    bridgeSettings_t settings = {
+        .bindAddr = htonl(INADDR_ANY),
+        .downlinkAddr = htonl(INADDR_BROADCAST),
+        .multicastAddr = 0,
+        .isDownlinkCompressed = TELEMETRY_DOWNLINK_COMPRESSION,
+    };
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:a:B:A:l:d:m:zvh")) != -1)
+    {
+        switch (opt)
+        {
+            case 't':
+                telemetryDevice = optarg;
+                break;
+            case 'a':
+                aatDevice = optarg;
+                break;
+            case 'B':
+                telemetryBaud = strtoul(optarg, NULL, 0);
+                break;
+            case 'A':
+                aatBaud = strtoul(optarg, NULL, 0);
+                break;
+            case 'l':
+            case 'd':
+            case 'm':
+                if (!parseAddr(optarg, (opt == 'l') ? &settings.bindAddr :
+                                       (opt == 'd') ? &settings.downlinkAddr : &settings.multicastAddr))
+                {
+                    fprintf(stderr, "Invalid address: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'z':
+                settings.isDownlinkCompressed = true;
+                break;
+            case 'v':
+                if (logLevel < HalLog_Debug)
+                    logLevel++;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (!telemetryDevice)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    hal_SetLogLevel((hal_LogLevel_t)logLevel);
+    hal_UartSetDevice(TELEMETRY_UART, telemetryDevice, telemetryBaud);
+    hal_UartSetDevice(AAT_UART, aatDevice, aatBaud);
+
+    bootTiming_Mark(BootPhase_AppStart);
+    bridge_Init();
+    bridge_Start(&settings);
+    bridge_Run();
+    return 0;
+}
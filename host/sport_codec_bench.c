@@ -0,0 +1,370 @@
+/**
+    @file
+    @brief   Host benchmark and round-trip test for the compressed downlink codec
+
+    Builds a synthetic SmartPort downlink: a receiver polling a typical set
+    of sensors (RSSI, battery, current, altitude, vario, GPS, accelerometer...)
+    whose values follow random walks, with GPS latitude and longitude sharing
+    a data ID as real sensors send them. Frames are grouped into datagrams
+    the way the bridge coalesces them and each datagram is encoded, decoded
+    and compared with the original bytes.
+
+    Reports compression ratio (payload only and with IP/UDP headers, i.e.
+    WiFi bytes), encode and decode cost per frame. With -l datagrams are
+    dropped at random before decoding: decoded datagrams must still match,
+    the ones whose key datagram was lost are counted as skipped.
+
+    Usage: sport_codec_bench [-n <frames>] [-f <frames/datagram>] [-k <key interval, datagrams>] [-l <loss %>] [-r <runs>]
+    Exit code is non-zero if a decoded datagram differs from the original.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "smartport.h"
+#include "sport_codec.h"
+
+#define IP_UDP_HEADER_SIZE      28
+#define MAX_FRAMES_PER_DATAGRAM 96
+
+typedef struct {
+    uint8_t physId;
+    uint16_t dataId;
+    int32_t value;
+    int32_t step;               // Max random walk step
+    uint8_t share;              // Frames per poll cycle (1 - every cycle)
+} benchSensor_t;
+
+typedef struct {
+    uint32_t frameCount;
+    uint32_t framesPerDatagram;
+    uint32_t keyInterval;       // Datagrams
+    uint32_t lossPercent;
+    uint32_t runs;
+} benchOptions_t;
+
+static benchOptions_t opts = {
+    .frameCount = 200000,
+    .framesPerDatagram = 4,
+    .keyInterval = 20,
+    .lossPercent = 0,
+    .runs = 5,
+};
+
+// Physical IDs with check bits, values in SmartPort units
+static benchSensor_t sensors[] = {
+    { 0x98, 0xF101, 90, 1, 1 },         // RSSI
+    { 0x98, 0xF104, 0, 0, 4 },          // RxBt
+    { 0xA1, 0x0210, 1620, 1, 1 },       // VFAS [0.01 V]
+    { 0xA1, 0x0200, 150, 8, 1 },        // Current [0.1 A]
+    { 0xA1, 0x0600, 1200, 1, 2 },       // Fuel [mAh]
+    { 0x1B, 0x0100, 12000, 20, 1 },     // Altitude [cm]
+    { 0x1B, 0x0110, 0, 40, 1 },         // Vario [cm/s]
+    { 0x83, 0x0800, 0, 0, 1 },          // GPS lat/lon, built below
+    { 0x83, 0x0820, 52000, 10, 2 },     // GPS altitude [cm]
+    { 0x83, 0x0830, 24000, 200, 2 },    // GPS speed [knots / 1000]
+    { 0x83, 0x0840, 18000, 150, 2 },    // Course [0.01 deg]
+    { 0x67, 0x0700, 0, 60, 1 },         // AccX [0.01 g]
+    { 0x67, 0x0710, 0, 60, 1 },         // AccY
+    { 0x67, 0x0720, 100, 60, 1 },       // AccZ
+    { 0x0D, 0x0500, 9000, 50, 2 },      // RPM
+    { 0x0D, 0x0400, 45, 1, 8 },         // Temp1
+};
+
+#define SENSOR_COUNT            (sizeof(sensors) / sizeof(sensors[0]))
+#define GPS_SENSOR              7
+
+static uint8_t *stream;                 // Frames as received by the bridge
+static uint32_t *datagramOffsets;       // Start of each datagram in stream, datagramCount + 1 entries
+static uint32_t datagramCount;
+static uint8_t *encoded;                // Encoded datagrams
+static uint32_t *encodedOffsets;
+static uint32_t rngState = 0x12345678;
+
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+static uint32_t rng(void)
+{
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+
+static uint32_t putStuffed(uint8_t *out, uint8_t byte)
+{
+    if ((byte == SPORT_START_BYTE) || (byte == SPORT_BYTESTUFF))
+    {
+        out[0] = SPORT_BYTESTUFF;
+        out[1] = byte ^ SPORT_STUFF_MASK;
+        return 2;
+    }
+    out[0] = byte;
+    return 1;
+}
+
+
+static uint32_t buildFrame(uint8_t *out, uint8_t physId, uint16_t dataId, uint32_t value)
+{
+    uint8_t payload[SPORT_PAYLOAD_SIZE];
+    uint32_t crc = 0;
+    uint32_t len = 0;
+    uint32_t i;
+
+    payload[0] = 0x10;
+    payload[1] = dataId & 0xFF;
+    payload[2] = dataId >> 8;
+    payload[3] = value & 0xFF;
+    payload[4] = (value >> 8) & 0xFF;
+    payload[5] = (value >> 16) & 0xFF;
+    payload[6] = value >> 24;
+    for (i = 0; i < SPORT_PAYLOAD_SIZE - 1; i++)
+    {
+        crc += payload[i];
+        crc += crc >> 8;
+        crc &= 0xFF;
+    }
+    payload[SPORT_PAYLOAD_SIZE - 1] = 0xFF - crc;
+
+    out[len++] = SPORT_START_BYTE;
+    out[len++] = physId;
+    for (i = 0; i < SPORT_PAYLOAD_SIZE; i++)
+        len += putStuffed(&out[len], payload[i]);
+    return len;
+}
+
+
+/**
+    @brief Next frame value of a sensor
+*/
+static uint32_t sensorValue(benchSensor_t *s, uint32_t index, uint32_t cycle)
+{
+    if (index == GPS_SENSOR)
+    {
+        // Latitude and longitude alternate: minutes / 10000 in bits 0..29, bit 31 - longitude
+        static int32_t lat = 2900000;
+        static int32_t lon = 840000;
+        bool isLon = cycle & 1;
+        if (isLon)
+        {
+            lon += (int32_t)(rng() % 11) - 5;
+            return (1u << 31) | (uint32_t)lon;
+        }
+        lat += (int32_t)(rng() % 11) - 5;
+        return (uint32_t)lat;
+    }
+    if (s->step > 0)
+        s->value += (int32_t)(rng() % (2 * s->step + 1)) - s->step;
+    return (uint32_t)s->value;
+}
+
+
+/**
+    @brief Generate frames in poll order and split them into datagrams
+*/
+static void buildStream(void)
+{
+    uint32_t frames = 0;
+    uint32_t len = 0;
+    uint32_t cycle = 0;
+
+    stream = malloc((size_t)opts.frameCount * SPORT_MAX_RAW_FRAME_SIZE);
+    datagramOffsets = malloc(sizeof(uint32_t) * (opts.frameCount / opts.framesPerDatagram + 2));
+    datagramCount = 0;
+    while (frames < opts.frameCount)
+    {
+        uint32_t i;
+        for (i = 0; (i < SENSOR_COUNT) && (frames < opts.frameCount); i++)
+        {
+            benchSensor_t *s = &sensors[i];
+            if (cycle % s->share)
+                continue;
+            if (frames % opts.framesPerDatagram == 0)
+                datagramOffsets[datagramCount++] = len;
+            len += buildFrame(&stream[len], s->physId, s->dataId, sensorValue(s, i, cycle / s->share));
+            frames++;
+        }
+        cycle++;
+    }
+    datagramOffsets[datagramCount] = len;
+}
+
+
+/**
+    @brief Encode all datagrams the way the bridge does, frame by frame
+    @return Encoded bytes
+*/
+static uint64_t encodeAll(sportEncoder_t *e)
+{
+    uint32_t d;
+    uint32_t len = 0;
+
+    sportEncoder_Init(e);
+    for (d = 0; d < datagramCount; d++)
+    {
+        uint32_t pos = datagramOffsets[d];
+        uint32_t end = datagramOffsets[d + 1];
+
+        if (d % opts.keyInterval == 0)
+            sportEncoder_Reset(e);
+        encodedOffsets[d] = len;
+        len += sportEncoder_Begin(e, &encoded[len]);
+        while (pos < end)
+        {
+            uint32_t frameEnd = pos + 1;
+            while ((frameEnd < end) && (stream[frameEnd] != SPORT_START_BYTE))
+                frameEnd++;
+            len += sportEncoder_PutFrame(e, &stream[pos], frameEnd - pos, &encoded[len]);
+            pos = frameEnd;
+        }
+    }
+    encodedOffsets[datagramCount] = len;
+    return len;
+}
+
+
+/**
+    @brief Decode all datagrams, dropping lossPercent of them, and compare with the stream
+    @param[out] decodedFrames Frames of datagrams that were decoded
+    @return Number of mismatching datagrams
+*/
+static uint32_t decodeAll(sportCodecDecoder_t *d, uint32_t lossPercent, uint64_t *decodedFrames)
+{
+    static uint8_t out[MAX_FRAMES_PER_DATAGRAM * SPORT_MAX_RAW_FRAME_SIZE];
+    uint32_t errors = 0;
+    uint32_t i;
+
+    sportCodecDecoder_Init(d);
+    *decodedFrames = 0;
+    for (i = 0; i < datagramCount; i++)
+    {
+        uint32_t outLen;
+        uint32_t rawLen = datagramOffsets[i + 1] - datagramOffsets[i];
+        uint32_t framesBefore = d->stats.frames;
+
+        if (lossPercent && (rng() % 100 < lossPercent))
+            continue;
+        sportCodecResult_t result = sportCodecDecoder_Decode(d, &encoded[encodedOffsets[i]],
+                                                             encodedOffsets[i + 1] - encodedOffsets[i],
+                                                             out, sizeof(out), &outLen);
+        if (result == SportCodec_Skipped)
+            continue;
+        if ((result != SportCodec_Ok) || (outLen != rawLen) ||
+            (memcmp(out, &stream[datagramOffsets[i]], rawLen) != 0))
+        {
+            if (errors == 0)
+                printf("FAIL: datagram %u, result %d, %u bytes decoded, expected %u\n", i, result, outLen, rawLen);
+            errors++;
+            continue;
+        }
+        *decodedFrames += d->stats.frames - framesBefore;
+    }
+    return errors;
+}
+
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  -n <frames>   number of frames (default %u)\n"
+        "  -f <frames>   frames per datagram, up to %u (default %u)\n"
+        "  -k <count>    key datagram interval [datagrams] (default %u)\n"
+        "  -l <percent>  datagram loss in the loss test (default %u, 0 - only 10 %% is tested)\n"
+        "  -r <runs>     timed runs, best one is reported (default %u)\n",
+        name, opts.frameCount, MAX_FRAMES_PER_DATAGRAM, opts.framesPerDatagram, opts.keyInterval,
+        opts.lossPercent, opts.runs);
+}
+
+
+int main(int argc, char *argv[])
+{
+    static sportEncoder_t encoder;
+    static sportCodecDecoder_t decoder;
+    double encodeNs = 0;
+    double decodeNs = 0;
+    uint64_t encodedBytes = 0;
+    uint64_t decodedFrames;
+    uint32_t errors = 0;
+    uint32_t run;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:f:k:l:r:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': opts.frameCount = strtoul(optarg, NULL, 0); break;
+            case 'f': opts.framesPerDatagram = strtoul(optarg, NULL, 0); break;
+            case 'k': opts.keyInterval = strtoul(optarg, NULL, 0); break;
+            case 'l': opts.lossPercent = strtoul(optarg, NULL, 0); break;
+            case 'r': opts.runs = strtoul(optarg, NULL, 0); break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if ((opts.frameCount == 0) || (opts.framesPerDatagram == 0) || (opts.framesPerDatagram > MAX_FRAMES_PER_DATAGRAM) ||
+        (opts.keyInterval == 0) || (opts.lossPercent > 100) || (opts.runs == 0))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    buildStream();
+    uint32_t rawBytes = datagramOffsets[datagramCount];
+    encoded = malloc(SPORT_CODEC_MAX_ENCODED_SIZE(rawBytes) + (size_t)datagramCount * SPORT_CODEC_MAX_ENCODED_SIZE(0));
+    encodedOffsets = malloc(sizeof(uint32_t) * (datagramCount + 1));
+    if (!stream || !datagramOffsets || !encoded || !encodedOffsets)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    for (run = 0; run < opts.runs; run++)
+    {
+        double t0 = now_ns();
+        encodedBytes = encodeAll(&encoder);
+        double t1 = now_ns();
+        errors += decodeAll(&decoder, 0, &decodedFrames);
+        double t2 = now_ns();
+        if ((run == 0) || (t1 - t0 < encodeNs))
+            encodeNs = t1 - t0;
+        if ((run == 0) || (t2 - t1 < decodeNs))
+            decodeNs = t2 - t1;
+    }
+
+    double rawWire = rawBytes + (double)datagramCount * IP_UDP_HEADER_SIZE;
+    double encodedWire = encodedBytes + (double)datagramCount * IP_UDP_HEADER_SIZE;
+    printf("== %u frames of %u sensors, %u frames/datagram, key every %u datagrams ==\n",
+           opts.frameCount, (unsigned)SENSOR_COUNT, opts.framesPerDatagram, opts.keyInterval);
+    printf("raw       %10u bytes, %.2f bytes/frame\n", rawBytes, (double)rawBytes / opts.frameCount);
+    printf("encoded   %10llu bytes, %.2f bytes/frame, %u literal frames\n",
+           (unsigned long long)encodedBytes, (double)encodedBytes / opts.frameCount, encoder.stats.literals);
+    printf("ratio     payload %.2fx, with IP/UDP headers %.2fx\n",
+           (double)rawBytes / encodedBytes, rawWire / encodedWire);
+    printf("encode    %.1f ns/frame, %.1f MB/s\n", encodeNs / opts.frameCount, rawBytes / encodeNs * 1e3);
+    printf("decode    %.1f ns/frame, %.1f MB/s\n", decodeNs / opts.frameCount, rawBytes / decodeNs * 1e3);
+    printf("round trip: %s\n", errors ? "FAIL" : "OK");
+
+    uint32_t lossPercent = opts.lossPercent ? opts.lossPercent : 10;
+    uint32_t lossErrors = decodeAll(&decoder, lossPercent, &decodedFrames);
+    printf("loss %u %%: %u datagrams lost, %u skipped for lost key, %.1f %% of frames decoded: %s\n",
+           lossPercent, decoder.stats.lost, decoder.stats.skipped, 100.0 * decodedFrames / opts.frameCount,
+           lossErrors ? "FAIL" : "OK");
+
+    return (errors || lossErrors) ? 2 : 0;
+}
@@ -0,0 +1,239 @@
+/**
+    @file
+    @brief   Receive the telemetry downlink and write the SmartPort stream
+
+    Listens for downlink datagrams of the bridge (ESP32 firmware or
+    udp_serial_bridge daemon) and writes the SmartPort frames they carry to
+    stdout or a file, e.g. a pty or serial device read by ground station
+    software. Compressed datagrams (TELEMETRY_DOWNLINK_COMPRESSION, daemon
+    option -z) are decoded by sport_codec.c into the bytes the bridge
+    received; everything else is written as it is. Uncompressed datagrams
+    usually start with a frame, but with OverflowPolicy_DropOldest the first
+    one may be cut, so they are told apart by the codec magic only, and a
+    datagram that carries the magic by chance but does not decode is written
+    as it is too.
+
+    With a bridge address the downlink is subscribed to, otherwise the
+    broadcast downlink is received. Counters are printed to stderr on exit.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "smartport.h"
+#include "sport_codec.h"
+#include "subscribers.h"
+#include "config.h"
+
+#define HELLO_PERIOD_MS         2000        // Well below TELEMETRY_SUBSCRIBER_TIMEOUT
+#define DATAGRAM_MAX            2048
+
+static volatile sig_atomic_t isStopped;
+
+static struct {
+    uint64_t datagrams;
+    uint64_t plainDatagrams;
+    uint64_t bytesIn;
+    uint64_t bytesOut;
+} counters;
+
+
+static void onSignal(int sig)
+{
+    (void)sig;
+    isStopped = 1;
+}
+
+
+static uint64_t now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+
+static void printCounters(const sportCodecDecoder_t *decoder)
+{
+    fprintf(stderr, "datagrams %llu (%llu plain), %llu bytes in, %llu bytes out, lost %u, skipped %u, invalid %u\n",
+            (unsigned long long)counters.datagrams, (unsigned long long)counters.plainDatagrams,
+            (unsigned long long)counters.bytesIn, (unsigned long long)counters.bytesOut,
+            decoder->stats.lost, decoder->stats.skipped, decoder->stats.invalid);
+}
+
+
+static bool writeAll(int fd, const uint8_t *data, uint32_t len)
+{
+    while (len > 0)
+    {
+        ssize_t written = write(fd, data, len);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("write");
+            return false;
+        }
+        data += written;
+        len -= written;
+    }
+    return true;
+}
+
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+        "Usage: %s [options] [bridge addr]\n"
+        "  -l <addr>     local address to listen on (default any)\n"
+        "  -p <port>     local port (default %u, receives the broadcast downlink)\n"
+        "  -o <file>     write the SmartPort stream to a file or device instead of stdout\n"
+        "  -v            print counters every second\n"
+        "With a bridge address, the downlink is subscribed to with hello datagrams.\n",
+        name, TELEMETRY_PORT);
+}
+
+
+int main(int argc, char *argv[])
+{
+    static sportCodecDecoder_t decoder;
+    static uint8_t datagram[DATAGRAM_MAX];
+    static uint8_t frames[DATAGRAM_MAX * SPORT_MAX_RAW_FRAME_SIZE];
+    struct sockaddr_in local = { .sin_family = AF_INET, .sin_port = htons(TELEMETRY_PORT) };
+    struct sockaddr_in bridge = { .sin_family = AF_INET, .sin_port = htons(TELEMETRY_PORT) };
+    struct timeval tv = { .tv_sec = 0, .tv_usec = 200000 };
+    bool isSubscribed = false;
+    bool isVerbose = false;
+    const char *outPath = NULL;
+    uint64_t lastHello = 0;
+    uint64_t lastReport = 0;
+    int outFd = STDOUT_FILENO;
+    int one = 1;
+    int sock;
+    int opt;
+
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    while ((opt = getopt(argc, argv, "l:p:o:vh")) != -1)
+    {
+        switch (opt)
+        {
+            case 'l':
+                if (inet_pton(AF_INET, optarg, &local.sin_addr) != 1)
+                {
+                    fprintf(stderr, "Invalid address: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'p':
+                local.sin_port = htons(strtoul(optarg, NULL, 0));
+                break;
+            case 'o':
+                outPath = optarg;
+                break;
+            case 'v':
+                isVerbose = true;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (optind < argc)
+    {
+        if (inet_pton(AF_INET, argv[optind], &bridge.sin_addr) != 1)
+        {
+            fprintf(stderr, "Invalid address: %s\n", argv[optind]);
+            return 1;
+        }
+        isSubscribed = true;
+    }
+
+    if (outPath)
+    {
+        outFd = open(outPath, O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY, 0644);
+        if (outFd < 0)
+        {
+            perror(outPath);
+            return 1;
+        }
+    }
+    sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0)
+    {
+        perror("socket");
+        return 1;
+    }
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    if (bind(sock, (struct sockaddr *)&local, sizeof(local)) < 0)
+    {
+        perror("bind");
+        return 1;
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    signal(SIGPIPE, SIG_IGN);
+    sportCodecDecoder_Init(&decoder);
+    while (!isStopped)
+    {
+        uint64_t now = now_ms();
+        if (isSubscribed && (now - lastHello >= HELLO_PERIOD_MS))
+        {
+            sendto(sock, TELEMETRY_HELLO_MAGIC, TELEMETRY_MAGIC_SIZE, 0, (struct sockaddr *)&bridge, sizeof(bridge));
+            lastHello = now;
+        }
+        if (isVerbose && (now - lastReport >= 1000))
+        {
+            printCounters(&decoder);
+            lastReport = now;
+        }
+
+        ssize_t len = recv(sock, datagram, sizeof(datagram), 0);
+        if (len <= 0)
+            continue;
+        counters.datagrams++;
+        counters.bytesIn += len;
+
+        const uint8_t *out = datagram;
+        uint32_t outLen = len;
+        sportCodecResult_t result = SportCodec_Invalid;
+        if ((datagram[0] & SPORT_CODEC_MAGIC_MASK) == SPORT_CODEC_MAGIC)
+            result = sportCodecDecoder_Decode(&decoder, datagram, len, frames, sizeof(frames), &outLen);
+        if (result == SportCodec_Ok)
+        {
+            out = frames;
+        }
+        else if (result == SportCodec_Skipped)
+        {
+            continue;
+        }
+        else
+        {
+            // Uncompressed downlink, its first frame may be cut by eviction
+            counters.plainDatagrams++;
+            outLen = len;
+        }
+        if (!writeAll(outFd, out, outLen))
+            break;
+        counters.bytesOut += outLen;
+    }
+
+    if (isSubscribed)
+        sendto(sock, TELEMETRY_BYE_MAGIC, TELEMETRY_MAGIC_SIZE, 0, (struct sockaddr *)&bridge, sizeof(bridge));
+    printCounters(&decoder);
+    return 0;
+}
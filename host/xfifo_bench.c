@@ -0,0 +1,542 @@
+/**
+    @file
+    @brief   Host benchmark and stress test for xFifo
+
+    Sections:
+    - xFifo vs compile-time typed FIFO (xfifo_typed.h), byte elements as in
+      smartPortDownlinkFifo. Each pass puts a chunk and gets it back, so
+      transfers cross the wrap point regularly.
+    - xFifo_Put / xFifo_Get cost per byte across element sizes, chunk sizes,
+      fill levels and wrap positions. Put is timed against a non-copying
+      xFifo_CommitRead(), Get against a non-copying xFifo_CommitWrite().
+    - xFifo_PeekAt and xFifo_PeekRange cost per call across element sizes
+      and offsets.
+    - xFifo_PutToTail cost per byte.
+    - Two-thread producer/consumer stress: sequence numbers are pushed
+      through the FIFO with varying chunk sizes and every API flavour, the
+      consumer checks that nothing is lost, duplicated or reordered. Then
+      the same with two xFifo_PutMP() producers.
+
+    Usage: xfifo_bench [-s <stress seconds>] [-q]
+    -q skips the typed FIFO comparison and uses shorter runs.
+    Exit code is non-zero if a stress run detects corrupted data.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "xfifo.h"
+#include "xfifo_typed.h"
+
+#define FIFO_SIZE           2048
+#define TOTAL_BYTES         (256u * 1024u * 1024u)
+#define CASE_BYTES          (32u * 1024u * 1024u)
+#define CASE_MAX_CALLS      (4u * 1024u * 1024u)
+#define MAX_ELEMENT_SIZE    64
+#define PEEK_CALLS          20000u
+#define PEEK_RANGE          64
+#define STRESS_FIFO_SIZE    1021            // Not a power of two, wrap lands on odd positions
+#define STRESS_MAX_CHUNK    64
+
+XFIFO_TYPED_DEFINE(byteFifo, uint8_t, FIFO_SIZE)
+
+static xFifo_t runtimeFifo;
+static byteFifo_t typedFifo;
+static uint8_t src[FIFO_SIZE * MAX_ELEMENT_SIZE];
+static uint8_t dst[FIFO_SIZE * MAX_ELEMENT_SIZE];
+static volatile uint32_t sink;
+static uint32_t caseBytes = CASE_BYTES;
+
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+//------------------- xFifo vs typed FIFO -------------------//
+
+static double bench_xfifo(uint32_t chunk)
+{
+    uint32_t i;
+    double t0 = now_ns();
+    for (i = 0; i < TOTAL_BYTES / chunk; i++)
+    {
+        xFifo_Put(&runtimeFifo, src, chunk);
+        sink += xFifo_Get(&runtimeFifo, dst, chunk);
+    }
+    return (now_ns() - t0) / TOTAL_BYTES;
+}
+
+
+static double bench_typed(uint32_t chunk)
+{
+    uint32_t i;
+    double t0 = now_ns();
+    for (i = 0; i < TOTAL_BYTES / chunk; i++)
+    {
+        byteFifo_Put(&typedFifo, src, chunk);
+        sink += byteFifo_Get(&typedFifo, dst, chunk);
+    }
+    return (now_ns() - t0) / TOTAL_BYTES;
+}
+
+
+static double bench_typed_one(void)
+{
+    uint32_t i;
+    uint8_t b = 0;
+    double t0 = now_ns();
+    for (i = 0; i < TOTAL_BYTES / 16; i++)
+    {
+        byteFifo_PutOne(&typedFifo, &b);
+        sink += byteFifo_GetOne(&typedFifo, &b);
+    }
+    return (now_ns() - t0) / (TOTAL_BYTES / 16);
+}
+
+
+static void run_typed_comparison(void)
+{
+    static const uint32_t chunks[] = {1, 3, 16, 100, 256};
+    uint32_t i;
+
+    xFifo_Create(&runtimeFifo, sizeof(uint8_t), FIFO_SIZE);
+    byteFifo_Init(&typedFifo);
+
+    printf("== xFifo vs typed FIFO, byte elements ==\n");
+    printf("%-8s %14s %14s\n", "chunk", "xFifo ns/B", "typed ns/B");
+    for (i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++)
+    {
+        double tx = bench_xfifo(chunks[i]);
+        double tt = bench_typed(chunks[i]);
+        printf("%-8u %14.3f %14.3f\n", chunks[i], tx, tt);
+    }
+    printf("typed PutOne/GetOne: %.3f ns/B\n\n", bench_typed_one());
+    free(runtimeFifo.data);
+}
+
+
+//------------------- Put / Get -------------------//
+
+static uint32_t caseCalls(uint32_t chunkBytes)
+{
+    uint32_t calls = caseBytes / chunkBytes;
+    return (calls > CASE_MAX_CALLS) ? CASE_MAX_CALLS : calls;
+}
+
+
+static double bench_put(xFifo_t *f, uint32_t chunk)
+{
+    uint32_t calls = caseCalls(chunk * f->elementSize);
+    uint32_t i;
+    double t0 = now_ns();
+    for (i = 0; i < calls; i++)
+    {
+        sink += xFifo_Put(f, src, chunk);
+        xFifo_CommitRead(f, chunk);
+    }
+    return (now_ns() - t0) / ((double)calls * chunk * f->elementSize);
+}
+
+
+static double bench_get(xFifo_t *f, uint32_t chunk)
+{
+    uint32_t calls = caseCalls(chunk * f->elementSize);
+    uint32_t i;
+    double t0 = now_ns();
+    for (i = 0; i < calls; i++)
+    {
+        xFifo_CommitWrite(f, chunk);
+        sink += xFifo_Get(f, dst, chunk);
+    }
+    return (now_ns() - t0) / ((double)calls * chunk * f->elementSize);
+}
+
+
+/**
+    @brief Put the FIFO indexes at startIndex with fill elements stored
+*/
+static void setup_state(xFifo_t *f, uint32_t startIndex, uint32_t fill)
+{
+    xFifo_Clear(f);
+    // Walk indexes to the requested storage position
+    xFifo_CommitWrite(f, startIndex);
+    xFifo_CommitRead(f, startIndex);
+    xFifo_CommitWrite(f, fill);
+}
+
+
+static void run_put_get(void)
+{
+    static const uint32_t elementSizes[] = {1, 4, 16, 64};
+    static const uint32_t chunks[] = {1, 16, 256};
+    static const uint32_t fillPercents[] = {0, 50, 90};
+    uint32_t e, c, l;
+
+    printf("== xFifo_Put / xFifo_Get, %u elements ==\n", FIFO_SIZE);
+    printf("wrap: transfers start half a chunk before the end of storage\n");
+    printf("%-6s %-6s %-6s %10s %10s %10s %10s\n",
+           "elem", "chunk", "fill%", "Put ns/B", "Put wrap", "Get ns/B", "Get wrap");
+    for (e = 0; e < sizeof(elementSizes) / sizeof(elementSizes[0]); e++)
+    {
+        xFifo_t f;
+        xFifo_Create(&f, elementSizes[e], FIFO_SIZE);
+        for (c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++)
+        {
+            uint32_t chunk = chunks[c];
+            uint32_t wrapStart = FIFO_SIZE - chunk / 2 - 1;
+            for (l = 0; l < sizeof(fillPercents) / sizeof(fillPercents[0]); l++)
+            {
+                uint32_t fill = FIFO_SIZE * fillPercents[l] / 100;
+                double putAligned, putWrap, getAligned, getWrap;
+                if (fill > FIFO_SIZE - chunk)
+                    fill = FIFO_SIZE - chunk;
+
+                // Put writes at head, which is fill elements past tail
+                setup_state(&f, (FIFO_SIZE - fill) % FIFO_SIZE, fill);
+                putAligned = bench_put(&f, chunk);
+                setup_state(&f, (wrapStart + FIFO_SIZE - fill) % FIFO_SIZE, fill);
+                putWrap = bench_put(&f, chunk);
+                // Get reads at tail
+                setup_state(&f, 0, fill);
+                getAligned = bench_get(&f, chunk);
+                setup_state(&f, wrapStart, fill);
+                getWrap = bench_get(&f, chunk);
+
+                printf("%-6u %-6u %-6u %10.3f %10.3f %10.3f %10.3f\n", elementSizes[e], chunk,
+                       fillPercents[l], putAligned, putWrap, getAligned, getWrap);
+            }
+        }
+        free(f.data);
+    }
+    printf("\n");
+}
+
+
+//------------------- PeekAt / PutToTail -------------------//
+
+static void run_peek_at(void)
+{
+    static const uint32_t elementSizes[] = {1, 4, 16};
+    static const uint32_t offsets[] = {0, 16, FIFO_SIZE / 2, FIFO_SIZE - PEEK_RANGE};
+    uint32_t e, o, r;
+
+    printf("== xFifo_PeekAt / xFifo_PeekRange(%u), full FIFO of %u elements, ns/call ==\n",
+           PEEK_RANGE, FIFO_SIZE);
+    printf("%-6s %-6s", "elem", "");
+    for (o = 0; o < sizeof(offsets) / sizeof(offsets[0]); o++)
+        printf(" %9s%-5u", "offset ", offsets[o]);
+    printf("\n");
+    for (e = 0; e < sizeof(elementSizes) / sizeof(elementSizes[0]); e++)
+    {
+        xFifo_t f;
+        xFifo_Create(&f, elementSizes[e], FIFO_SIZE);
+        // Data starts in the middle of storage so that far offsets wrap
+        setup_state(&f, FIFO_SIZE / 2 + 1, FIFO_SIZE);
+        for (r = 0; r < 2; r++)
+        {
+            printf("%-6u %-6s", elementSizes[e], r ? "range" : "at");
+            for (o = 0; o < sizeof(offsets) / sizeof(offsets[0]); o++)
+            {
+                uint32_t i;
+                double t0 = now_ns();
+                for (i = 0; i < PEEK_CALLS; i++)
+                {
+                    if (r)
+                        sink += xFifo_PeekRange(&f, dst, offsets[o], PEEK_RANGE);
+                    else
+                        sink += xFifo_PeekAt(&f, dst, offsets[o]);
+                }
+                printf(" %14.1f", (now_ns() - t0) / PEEK_CALLS);
+            }
+            printf("\n");
+        }
+        free(f.data);
+    }
+    printf("\n");
+}
+
+
+static void run_put_to_tail(void)
+{
+    static const uint32_t elementSizes[] = {1, 4, 16};
+    static const uint32_t chunks[] = {1, 16};
+    uint32_t e, c;
+
+    printf("== xFifo_PutToTail, half full FIFO ==\n");
+    printf("%-6s %-6s %10s\n", "elem", "chunk", "ns/B");
+    for (e = 0; e < sizeof(elementSizes) / sizeof(elementSizes[0]); e++)
+    {
+        xFifo_t f;
+        xFifo_Create(&f, elementSizes[e], FIFO_SIZE);
+        for (c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++)
+        {
+            uint32_t chunk = chunks[c];
+            uint32_t calls = caseCalls(chunk * elementSizes[e]) / 4;
+            uint32_t i;
+            double t0;
+
+            setup_state(&f, 0, FIFO_SIZE / 2);
+            t0 = now_ns();
+            for (i = 0; i < calls; i++)
+            {
+                // Discarding the inserted elements keeps fill level and tail position
+                sink += xFifo_PutToTail(&f, src, chunk);
+                xFifo_Get(&f, NULL, chunk);
+            }
+            printf("%-6u %-6u %10.3f\n", elementSizes[e], chunk,
+                   (now_ns() - t0) / ((double)calls * chunk * elementSizes[e]));
+        }
+        free(f.data);
+    }
+    printf("\n");
+}
+
+
+//------------------- Stress -------------------//
+
+static xFifo_t stressFifo;
+static atomic_bool stressStop;
+static atomic_uint producersLeft;
+
+typedef struct {
+    uint32_t id;
+    bool multiProducer;
+    uint64_t produced;
+} stressProducer_t;
+
+
+static uint32_t nextRandom(uint32_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+
+static void *stress_producer(void *arg)
+{
+    stressProducer_t *p = (stressProducer_t *)arg;
+    uint32_t values[STRESS_MAX_CHUNK];
+    uint32_t seq = 0;
+    uint32_t rnd = 0x12345u + p->id;
+
+    while (!atomic_load_explicit(&stressStop, memory_order_relaxed))
+    {
+        uint32_t r = nextRandom(&rnd);
+        uint32_t count = 1 + r % STRESS_MAX_CHUNK;
+        uint32_t i, put;
+
+        for (i = 0; i < count; i++)
+            values[i] = (p->id << 28) | ((seq + i) & 0x0FFFFFFF);
+
+        if (p->multiProducer)
+            put = xFifo_PutMP(&stressFifo, values, count);
+        else if ((r >> 8) % 3 == 0)
+            put = xFifo_Put(&stressFifo, values, count);
+        else if ((r >> 8) % 3 == 1)
+        {
+            xFifo_Span_t spans[2];
+            uint32_t n = xFifo_GetWriteSpans(&stressFifo, spans);
+            uint32_t first;
+            if (n > count)
+                n = count;
+            first = (spans[0].count < n) ? spans[0].count : n;
+            memcpy(spans[0].ptr, values, first * sizeof(uint32_t));
+            if (n > first)
+                memcpy(spans[1].ptr, &values[first], (n - first) * sizeof(uint32_t));
+            put = xFifo_CommitWrite(&stressFifo, n);
+        }
+        else
+        {
+            uint32_t *slot = (uint32_t *)xFifo_GetInsertPtr(&stressFifo);
+            put = 0;
+            if (slot)
+            {
+                *slot = values[0];
+                put = xFifo_AcceptInsert(&stressFifo);
+            }
+        }
+        seq += put;
+        if (put == 0)
+            sched_yield();
+    }
+    p->produced = seq;
+    atomic_fetch_sub(&producersLeft, 1);
+    return NULL;
+}
+
+
+/**
+    @brief Consume and verify stress data
+    @param[in]  producerCount Number of producers, ids 0..producerCount-1
+    @return Number of elements consumed, 0 on integrity error
+*/
+static uint64_t stress_consumer(uint32_t producerCount)
+{
+    uint32_t expected[4] = {0};
+    uint32_t values[STRESS_MAX_CHUNK];
+    uint32_t rnd = 0xC0FFEEu;
+    uint64_t consumed = 0;
+
+    for (;;)
+    {
+        uint32_t r = nextRandom(&rnd);
+        uint32_t count = 1 + r % STRESS_MAX_CHUNK;
+        uint32_t got, i;
+
+        if ((r >> 8) % 3 == 0)
+            got = xFifo_Get(&stressFifo, values, count);
+        else if ((r >> 8) % 3 == 1)
+        {
+            xFifo_Span_t spans[2];
+            uint32_t n = xFifo_GetReadSpans(&stressFifo, spans);
+            uint32_t first;
+            if (n > count)
+                n = count;
+            first = (spans[0].count < n) ? spans[0].count : n;
+            memcpy(values, spans[0].ptr, first * sizeof(uint32_t));
+            if (n > first)
+                memcpy(&values[first], spans[1].ptr, (n - first) * sizeof(uint32_t));
+            got = xFifo_CommitRead(&stressFifo, n);
+        }
+        else
+        {
+            got = xFifo_Peek(&stressFifo, values);
+            if (got)
+                xFifo_AcceptPeek(&stressFifo);
+        }
+
+        for (i = 0; i < got; i++)
+        {
+            uint32_t id = values[i] >> 28;
+            if ((id >= producerCount) || ((values[i] & 0x0FFFFFFF) != (expected[id] & 0x0FFFFFFF)))
+            {
+                printf("FAIL: element %llu is 0x%08X, expected producer %u seq %u\n",
+                       (unsigned long long)consumed + i, values[i], id, expected[id & 3]);
+                return 0;
+            }
+            expected[id]++;
+        }
+        consumed += got;
+        if (got == 0)
+        {
+            if ((atomic_load(&producersLeft) == 0) && (xFifo_DataAvaliable(&stressFifo) == 0))
+                break;
+            sched_yield();
+        }
+    }
+    return consumed;
+}
+
+
+static void *stress_timer(void *arg)
+{
+    uint32_t seconds = *(uint32_t *)arg;
+    uint32_t ms;
+    // Wake up often to notice an early stop after an integrity error
+    for (ms = 0; (ms < seconds * 1000) && !atomic_load(&stressStop); ms += 10)
+        usleep(10000);
+    atomic_store(&stressStop, true);
+    return NULL;
+}
+
+
+static bool run_stress(uint32_t producerCount, uint32_t seconds)
+{
+    stressProducer_t producers[4];
+    pthread_t threads[4];
+    pthread_t timer;
+    uint64_t produced = 0;
+    uint64_t consumed;
+    uint32_t i;
+    double t0, elapsed;
+
+    xFifo_Create(&stressFifo, sizeof(uint32_t), STRESS_FIFO_SIZE);
+    atomic_store(&stressStop, false);
+    atomic_store(&producersLeft, producerCount);
+
+    t0 = now_ns();
+    for (i = 0; i < producerCount; i++)
+    {
+        producers[i].id = i;
+        producers[i].multiProducer = (producerCount > 1);
+        producers[i].produced = 0;
+        pthread_create(&threads[i], NULL, stress_producer, &producers[i]);
+    }
+    // Consumer runs here, timer thread stops producers after the run time
+    pthread_create(&timer, NULL, stress_timer, &seconds);
+    consumed = stress_consumer(producerCount);
+    if (consumed == 0)
+        atomic_store(&stressStop, true);
+    pthread_join(timer, NULL);
+    for (i = 0; i < producerCount; i++)
+    {
+        pthread_join(threads[i], NULL);
+        produced += producers[i].produced;
+    }
+    elapsed = (now_ns() - t0) / 1e9;
+    free(stressFifo.data);
+
+    printf("%u producer(s)%s: %llu elements in %.2f s, %.1f M elements/s, %.1f MB/s",
+           producerCount, (producerCount > 1) ? " (PutMP)" : "",
+           (unsigned long long)consumed, elapsed, consumed / elapsed / 1e6,
+           consumed * sizeof(uint32_t) / elapsed / 1e6);
+    if ((consumed == 0) || (consumed != produced))
+    {
+        printf(" - FAIL, produced %llu\n", (unsigned long long)produced);
+        return false;
+    }
+    printf(" - OK\n");
+    return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+    uint32_t stressSeconds = 2;
+    bool quick = false;
+    bool ok;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:q")) != -1)
+    {
+        switch (opt)
+        {
+            case 's':
+                stressSeconds = strtoul(optarg, NULL, 0);
+                break;
+            case 'q':
+                quick = true;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-s <stress seconds>] [-q]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (quick)
+        caseBytes = CASE_BYTES / 16;
+    else
+        run_typed_comparison();
+
+    run_put_get();
+    run_peek_at();
+    run_put_to_tail();
+
+    printf("== Stress, %u-element FIFO of uint32_t ==\n", STRESS_FIFO_SIZE);
+    ok = run_stress(1, stressSeconds);
+    ok = run_stress(2, stressSeconds) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+/**
+    @file
+    @brief   Boot phase timing
+*/
+
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "hal.h"
+#include "boot_timing.h"
+#include "bridge_stats.h"
+#include "dlog.h"
+
+//------------ Definitions ----------//
+
+//------------ Variables ------------//
+
+static const char *BOOT_TAG = "Boot";
+
+static int64_t appStartTime;                        // [us]
+static atomic_bool isMarked[BootPhase_Count];
+
+static const bridgeStat_t phaseStats[BootPhase_Count] = {
+    [BootPhase_AppStart] = BridgeStat_Count,        // Reference, not exported
+    [BootPhase_NvsReady] = BridgeStat_BootNvsReadyMs,
+    [BootPhase_UartsReady] = BridgeStat_BootUartsReadyMs,
+    [BootPhase_WifiStarted] = BridgeStat_BootWifiStartedMs,
+    [BootPhase_SocketBound] = BridgeStat_BootSocketBoundMs,
+    [BootPhase_FirstUartData] = BridgeStat_BootFirstUartDataMs,
+    [BootPhase_FirstDatagram] = BridgeStat_BootFirstDatagramMs,
+};
+
+//------------ Externals ------------//
+
+//------------ Prototypes -----------//
+
+//--------- Implementation ----------//
+
+
+/**
+    @brief  Mark completion of boot phase, later marks of the same phase are ignored
+            Cheap after the first mark, may be called from hot paths
+    @param[in]  phase Boot phase
+    @return None
+*/
+void bootTiming_Mark(bootPhase_t phase)
+{
+    if (atomic_load_explicit(&isMarked[phase], memory_order_relaxed) || atomic_exchange(&isMarked[phase], true))
+        return;
+
+    int64_t now = hal_GetTimeUs();
+    if (phase == BootPhase_AppStart)
+    {
+        appStartTime = now;
+        return;
+    }
+    // Rounded up, so a reached phase is never reported as 0
+    bridgeStats_Set(phaseStats[phase], (uint32_t)((now - appStartTime + 999) / 1000));
+
+    if (phase == BootPhase_FirstDatagram)
+    {
+        DLOGI(BOOT_TAG, "boot [ms]: nvs %u, uarts %u, wifi %u, socket %u, first rx %u, first datagram %u",
+              bridgeStats_Get(BridgeStat_BootNvsReadyMs), bridgeStats_Get(BridgeStat_BootUartsReadyMs),
+              bridgeStats_Get(BridgeStat_BootWifiStartedMs), bridgeStats_Get(BridgeStat_BootSocketBoundMs),
+              bridgeStats_Get(BridgeStat_BootFirstUartDataMs), bridgeStats_Get(BridgeStat_BootFirstDatagramMs));
+    }
+}
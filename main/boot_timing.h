@@ -0,0 +1,37 @@
+/**
+    @file
+    @brief   Boot phase timing
+
+    Boot phases are marked by the code that completes them; only the first
+    mark of each phase counts. Times are relative to BootPhase_AppStart and
+    are exported as stats counters (0 - phase not reached, e.g. no WiFi on
+    the host build). When the first telemetry datagram is sent, all phase
+    times are logged in a single line.
+*/
+
+#ifndef __BOOT_TIMING_H__
+#define __BOOT_TIMING_H__
+
+typedef enum {
+    BootPhase_AppStart,         // Reference point, must be marked first
+    BootPhase_NvsReady,
+    BootPhase_UartsReady,       // UART ingest is running, telemetry is buffered
+    BootPhase_WifiStarted,
+    BootPhase_SocketBound,      // Telemetry socket is bound, buffered data is flushed
+    BootPhase_FirstUartData,
+    BootPhase_FirstDatagram,
+    BootPhase_Count
+} bootPhase_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    void bootTiming_Mark(bootPhase_t phase);
+
+#ifdef __cplusplus
+}   // extern "C"
+#endif
+
+#endif // __BOOT_TIMING_H__
@@ -0,0 +1,1616 @@
+/**
+    @file
+    @brief   UART <-> UDP bridge logic
+
+    Platform independent part of the bridge. All platform services are used
+    through hal.h and drv_led.h. Data paths between UART links and UDP
+    endpoints are defined by the channel and route tables, see router.h.
+*/
+
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "hal.h"
+#include "bridge.h"
+#include "xfifo.h"
+#include "config.h"
+#include "led_indication.h"
+#include "smartport.h"
+#include "bridge_stats.h"
+#include "dlog.h"
+#include "subscribers.h"
+#include "timer_service.h"
+#include "router.h"
+#include "buffer_pool.h"
+#include "boot_timing.h"
+#include "sport_codec.h"
+
+static const char TELEM_TAG[] = "Telemetry server";
+static const char CONFIG_TAG[] = "Config server";
+static const char AAT_TAG[] = "AAT UART";
+
+static bridgeSettings_t bridgeSettings;
+
+xFifo_t smartPortDownlinkFifo;      // R9M -> UART -> UDP -> Ground Station
+xFifo_t smartPortUplinkFifo;        // Ground Station -> UDP -> UART -> R9M, records of length byte and datagram
+
+xFifo_t configDownlinkFifo;         // AAT -> UART -> UDP -> Configurator, pool buffers as read from UART
+// Configurator -> UDP -> UART -> AAT goes directly into AAT UART driver TX buffer
+
+// smartPortDownlinkFifo overflow policies, see TELEMETRY_DOWNLINK_OVERFLOW_POLICY
+typedef enum {
+    OverflowPolicy_DropNewest,          // New frame is dropped, FIFO stays lock-free
+    OverflowPolicy_DropOldest,          // Oldest bytes are evicted, the first frame sent afterwards may be cut
+    OverflowPolicy_DropOldestFrames,    // Oldest whole frames are evicted
+} overflowPolicy_t;
+
+// Producer evicts data, so it and the consumer lock the read side of smartPortDownlinkFifo.
+// The consumer copies the datagram out under the lock and sends it afterwards.
+#define DOWNLINK_EVICTS                 (TELEMETRY_DOWNLINK_OVERFLOW_POLICY != OverflowPolicy_DropNewest)
+
+static hal_Mutex_t downlinkReadMutex;              // Used if DOWNLINK_EVICTS only
+static uint8_t downlinkDatagram[TELEMETRY_DATAGRAM_SIZE];  // Uncompressed datagram, used if DOWNLINK_EVICTS only
+
+static uint8_t smartPortDownlinkStorage[TELEMETRY_DOWNLINK_FIFO_SIZE];
+
+// Compressed downlink, used by telemetry server only
+static sportEncoder_t downlinkEncoder;
+static int64_t downlinkKeyTime;                    // Last key datagram [us]
+static bool isDownlinkKeyWanted;                   // New subscriber waits for a key datagram
+static uint8_t downlinkEncoded[SPORT_CODEC_MAX_ENCODED_SIZE(TELEMETRY_CODEC_DATAGRAM_SIZE)];
+_Static_assert(sizeof(downlinkEncoded) <= 1472, "compressed downlink datagram must fit into MTU");
+static uint8_t smartPortUplinkStorage[TELEMETRY_UPLINK_FIFO_SIZE];
+static bufferPool_Buffer_t *configDownlinkStorage[CONFIG_DOWNLINK_QUEUE_SIZE];
+
+// UART reads and received datagrams, shared by all sinks of a route
+static bufferPool_t bufferPool;
+static _Alignas(8) uint8_t bufferPoolStorage[BUFFER_POOL_STORAGE_SIZE(BUFFER_POOL_BLOCK_SIZE, BUFFER_POOL_BLOCK_COUNT)];
+
+static timerService_Timer_t aatConfigModeTimer;    // Leaves config mode after AAT_CONFIG_TIMEOUT
+static int64_t aatConfigModeStartTime;             // [us]
+static atomic_bool isAatConfigModeExpired;         // Set by timer service, handled by config_server_task
+static timerService_Timer_t telemetryTimeoutTimer; // Detects loss of telemetry UART data
+static atomic_bool isTelemetryLost;                // Nothing received for TELEMETRY_TIMEOUT, timer is not armed
+static int64_t bridgeStartTime;                    // [us]
+
+static sportDecoder_t telemetryDecoder;            // Used by telemetry UART reader only
+static atomic_bool telemetryDownlinkFlush;         // Telemetry UART line is idle, send held downlink data
+static atomic_uint telemetryLastRxTime;            // Last telemetry UART read [us, lower 32 bits]
+
+// Uplink writer pacing, slot is opened by telemetry UART reader
+static hal_Signal_t uplinkSignal;                  // Uplink datagram queued or poll slot opened
+static atomic_bool uplinkSlotOpen;                 // TELEMETRY_UPLINK_PHYS_ID was polled and line is idle
+static atomic_uint uplinkSlotTime;                 // [us, lower 32 bits]
+
+// Loopback socket pair used by producers to wake a server task waiting in select()
+typedef struct {
+    int rxSock;                 // Included into server task select() set
+    atomic_int txSock;          // Used by ringDoorbell()
+    atomic_bool pending;        // Doorbell datagram is in flight
+    struct sockaddr_in addr;
+} doorbell_t;
+
+static doorbell_t telemetryDoorbell = { .rxSock = -1, .txSock = -1 };
+static doorbell_t configDoorbell = { .rxSock = -1, .txSock = -1 };
+
+// Bridge channels, indexes into bridgeChannels
+typedef enum {
+    Channel_TelemetryUart,
+    Channel_AatUart,
+    Channel_TelemetryUdp,
+    Channel_ConfigUdp,
+    Channel_Count
+} bridgeChannel_t;
+
+// Route condition flags
+#define ROUTE_FLAG_AAT_CONFIG_MODE      (1u << 0)   // Configurator session is active, AAT UART is used by it
+
+// UART link, read by uart_reader_task and forwarded from its channel
+typedef struct {
+    hal_UartConfig_t config;
+    bridgeChannel_t channel;
+    const char *tag;
+    const char *taskName;
+    uint32_t taskPriority;
+    bridgeStat_t statRxBytes;
+    bridgeStat_t statOverflows;
+    bridgeStat_t statBreaks;
+    bridgeStat_t statFrameErrors;
+    void (*afterRead)(uint32_t readBytes, bool isLineIdle);    // Called after each read of buffered data, may be NULL
+    bool isAutobaudAtStart;
+    bridgeStat_t statBaudRate;
+    bridgeStat_t statAutobaudGood;  // Grows when data is received at the right rate
+    bridgeStat_t statAutobaudBad;   // Grows when data is received at a wrong rate
+    uint32_t autobaudMinGood;       // Increase of statAutobaudGood within UART_AUTOBAUD_DWELL_TIME that locks the rate
+} uartLink_t;
+
+// Baud rate state of UART link, owned by config_server_task (and bridge_Init before tasks start)
+typedef struct {
+    bridgeAutobaud_t autobaud;
+    uint32_t candidate;             // Index into autobaudRates
+    uint32_t goodStart;             // statAutobaudGood when candidate rate was set
+    uint32_t badStart;              // statAutobaudBad when candidate rate was set
+    timerService_Timer_t autobaudTimer;
+} uartLinkState_t;
+
+static uint32_t uartSink(void *ctx, bufferPool_Buffer_t *buf);
+static uint32_t uplinkSink(void *ctx, bufferPool_Buffer_t *buf);
+static uint32_t sportDownlinkSink(void *ctx, bufferPool_Buffer_t *buf);
+static uint32_t configDownlinkSink(void *ctx, bufferPool_Buffer_t *buf);
+static void telemetryAfterRead(uint32_t readBytes, bool isLineIdle);
+
+static const int aatUartPort = AAT_UART;
+
+static const router_Channel_t bridgeChannels[Channel_Count] = {
+    // Written by telemetry_uplink_task in SmartPort poll slots
+    [Channel_TelemetryUart] = { "telemetry UART", uplinkSink, NULL },
+    [Channel_AatUart] = { "AAT UART", uartSink, (void *)&aatUartPort },
+    // Sent by telemetry_server_task and config_server_task from their FIFOs
+    [Channel_TelemetryUdp] = { "telemetry UDP", sportDownlinkSink, NULL },
+    [Channel_ConfigUdp] = { "config UDP", configDownlinkSink, NULL },
+};
+
+static const router_Route_t bridgeRoutes[] = {
+    //  source                  sink                    flagsMask                   flagsValue
+    //  statBytes                       statDropped                                 statSkipped
+    // Raw telemetry to AAT, paused while configurator uses AAT UART
+    {   Channel_TelemetryUart,  Channel_AatUart,        ROUTE_FLAG_AAT_CONFIG_MODE, 0,
+        BridgeStat_AatTelemetryBytes,   BridgeStat_AatTelemetryDroppedBytes,        BridgeStat_AatTelemetrySkippedBytes },
+    // Whole valid SmartPort frames to ground stations, counted by sink
+    {   Channel_TelemetryUart,  Channel_TelemetryUdp,   0,                          0,
+        ROUTER_NO_STAT,                 ROUTER_NO_STAT,                             ROUTER_NO_STAT },
+    // Ground station datagrams to receiver, counted by sink
+    {   Channel_TelemetryUdp,   Channel_TelemetryUart,  0,                          0,
+        ROUTER_NO_STAT,                 ROUTER_NO_STAT,                             ROUTER_NO_STAT },
+    {   Channel_AatUart,        Channel_ConfigUdp,      0,                          0,
+        ROUTER_NO_STAT,                 BridgeStat_ConfigDownlinkFifoDroppedBytes,  ROUTER_NO_STAT },
+    {   Channel_ConfigUdp,      Channel_AatUart,        0,                          0,
+        ROUTER_NO_STAT,                 BridgeStat_ConfigUplinkDroppedBytes,        ROUTER_NO_STAT },
+};
+
+static const uartLink_t uartLinks[] = {
+    {
+        .config = {
+            .port = TELEMETRY_UART,
+            .baudRate = TELEMETRY_BAUD_RATE,
+            .txPin = TELEMETRY_TX_PIN,
+            .rxPin = TELEMETRY_RX_PIN,
+            .rxTimeout = TELEMETRY_RX_TIMEOUT,
+        },
+        .channel = Channel_TelemetryUart,
+        .tag = TELEM_TAG,
+        .taskName = "telemetry_mux",
+        .taskPriority = 6,              // Must have priority higher than config_server
+        .statRxBytes = BridgeStat_TelemetryUartRxBytes,
+        .statOverflows = BridgeStat_TelemetryUartOverflows,
+        .statBreaks = BridgeStat_TelemetryUartBreaks,
+        .statFrameErrors = BridgeStat_TelemetryUartFrameErrors,
+        .afterRead = telemetryAfterRead,
+        .isAutobaudAtStart = TELEMETRY_AUTOBAUD,
+        .statBaudRate = BridgeStat_TelemetryUartBaudRate,
+        .statAutobaudGood = BridgeStat_SportFrames,
+        .statAutobaudBad = BridgeStat_SportCrcErrors,
+        .autobaudMinGood = 3,
+    },
+    {
+        .config = {
+            .port = AAT_UART,
+            .baudRate = AAT_BAUD_RATE,
+            .txPin = AAT_TX_PIN,
+            .rxPin = AAT_RX_PIN,
+            .rxTimeout = AAT_RX_TIMEOUT,
+        },
+        .channel = Channel_AatUart,
+        .tag = AAT_TAG,
+        .taskName = "aat_reader",
+        .taskPriority = 5,
+        .statRxBytes = BridgeStat_AatUartRxBytes,
+        .statOverflows = BridgeStat_AatUartOverflows,
+        .statBreaks = BridgeStat_AatUartBreaks,
+        .statFrameErrors = BridgeStat_AatUartFrameErrors,
+        .afterRead = NULL,
+        .isAutobaudAtStart = AAT_AUTOBAUD,
+        .statBaudRate = BridgeStat_AatUartBaudRate,
+        .statAutobaudGood = BridgeStat_AatUartRxBytes,
+        .statAutobaudBad = BridgeStat_AatUartFrameErrors,
+        .autobaudMinGood = 16,
+    },
+};
+
+#define UART_LINK_COUNT                 (sizeof(uartLinks) / sizeof(uartLinks[0]))
+#define BRIDGE_ROUTE_COUNT              (sizeof(bridgeRoutes) / sizeof(bridgeRoutes[0]))
+
+static const uint32_t autobaudRates[] = { UART_AUTOBAUD_RATES };
+#define AUTOBAUD_RATE_COUNT             (sizeof(autobaudRates) / sizeof(autobaudRates[0]))
+
+static uartLinkState_t uartLinkStates[UART_LINK_COUNT];
+static atomic_uint autobaudDueLinks;               // Bit per link whose dwell time expired, set by timer service
+
+#define TELEMETRY_TIMEOUT               1000    // [ms]
+
+
+/**
+    @brief  Get byte from FIFO read spans by offset
+    @param[in]  spans Spans returned by xFifo_GetReadSpans()
+    @param[in]  offset Byte offset from the oldest byte
+    @return Byte value
+*/
+static inline uint8_t spanByteAt(const xFifo_Span_t spans[2], uint32_t offset)
+{
+    if (offset < spans[0].count)
+        return ((const uint8_t *)spans[0].ptr)[offset];
+    return ((const uint8_t *)spans[1].ptr)[offset - spans[0].count];
+}
+
+
+/**
+    @brief  Create loopback doorbell socket used to wake a server task
+            lwIP select() cannot wait for a task notification, so the downlink FIFO producer
+            notifies the server by sending a datagram to this socket instead
+    @param[out] doorbell Doorbell
+    @param[in]  tag Log tag of the server task
+    @return None
+*/
+static void createDoorbell(doorbell_t *doorbell, const char *tag)
+{
+    struct sockaddr_in addr;
+    socklen_t addrLen = sizeof(addr);
+
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_family = AF_INET;
+    addr.sin_port = 0;
+
+    int rxSock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    int txSock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if ((rxSock < 0) || (txSock < 0) ||
+        (bind(rxSock, (struct sockaddr*) &addr, sizeof(addr)) < 0) ||
+        (getsockname(rxSock, (struct sockaddr*) &addr, &addrLen) < 0))
+    {
+        HAL_LOGE(tag, "Unable to create doorbell socket: errno %d", errno);
+        if (rxSock >= 0)
+            close(rxSock);
+        if (txSock >= 0)
+            close(txSock);
+        return;
+    }
+    doorbell->addr = addr;
+    doorbell->rxSock = rxSock;
+    atomic_store(&doorbell->txSock, txSock);
+}
+
+
+/**
+    @brief  Wake server task after data was put into its FIFO
+            At most one doorbell datagram is in flight at any time
+    @param[in]  doorbell Doorbell
+    @return None
+*/
+static void ringDoorbell(doorbell_t *doorbell)
+{
+    int txSock = atomic_load(&doorbell->txSock);
+    if (txSock < 0)
+        return;
+    if (!atomic_exchange(&doorbell->pending, true))
+    {
+        sendto(txSock, "", 1, 0, (struct sockaddr*) &doorbell->addr, sizeof(doorbell->addr));
+    }
+}
+
+
+/**
+    @brief  Consume doorbell datagram, called by server task when doorbell socket is readable
+            Must be called before the FIFO is drained, so data put after this point rings again
+    @param[in]  doorbell Doorbell
+    @return None
+*/
+static void rearmDoorbell(doorbell_t *doorbell)
+{
+    uint8_t tmp[4];
+    while (recv(doorbell->rxSock, tmp, sizeof(tmp), MSG_DONTWAIT) > 0) {}
+    atomic_store(&doorbell->pending, false);
+}
+
+
+/**
+    @brief  Add socket to select() read set
+    @param[in]  sock Socket, ignored if negative
+    @param[in,out]  readSet Read set
+    @param[in,out]  maxFd Highest descriptor in the set
+    @return None
+*/
+static void addToReadSet(int sock, fd_set *readSet, int *maxFd)
+{
+    if (sock < 0)
+        return;
+    FD_SET(sock, readSet);
+    if (sock > *maxFd)
+        *maxFd = sock;
+}
+
+
+/**
+    @brief  Create UDP socket bound to bridgeSettings.bindAddr
+    @param[in]  port Port to bind
+    @param[in]  isBroadcast Allow sending to broadcast address
+    @param[in]  tag Log tag
+    @return Socket, -1 on error
+*/
+static int createBoundSocket(uint16_t port, bool isBroadcast, const char *tag)
+{
+    struct sockaddr_in bindAddr;
+    bindAddr.sin_addr.s_addr = bridgeSettings.bindAddr;
+    bindAddr.sin_family = AF_INET;
+    bindAddr.sin_port = htons(port);
+
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (sock < 0)
+    {
+        HAL_LOGE(tag, "Unable to create socket: errno %d", errno);
+        return -1;
+    }
+    int bcastEnabled = 1;
+    if (isBroadcast && (setsockopt(sock, SOL_SOCKET, SO_BROADCAST, &bcastEnabled, sizeof(bcastEnabled)) < 0))
+    {
+        HAL_LOGE(tag, "Broadcast permission failed");
+        close(sock);
+        return -1;
+    }
+    if (bind(sock, (struct sockaddr*) &bindAddr, sizeof(bindAddr)) < 0)
+    {
+        HAL_LOGE(tag, "Socket unable to bind: errno %d", errno);
+        close(sock);
+        return -1;
+    }
+    HAL_LOGI(tag, "Socket created and bound, port %d", port);
+    return sock;
+}
+
+
+/**
+    @brief  Receive datagram into a pool buffer
+            If the pool is exhausted the datagram is dropped, so select() does not report it again
+    @param[in]  sock Socket
+    @param[out] sourceAddr Sender address
+    @param[out] socklen Size of sourceAddr
+    @return Buffer holding datagram, NULL if nothing was received
+*/
+static bufferPool_Buffer_t *receiveDatagram(int sock, struct sockaddr_storage *sourceAddr, socklen_t *socklen)
+{
+    uint8_t discard;
+    bufferPool_Buffer_t *buf = bufferPool_Alloc(&bufferPool);
+
+    *socklen = sizeof(*sourceAddr);
+    if (!buf)
+    {
+        recvfrom(sock, &discard, sizeof(discard), MSG_DONTWAIT, (struct sockaddr*) sourceAddr, socklen);
+        return NULL;
+    }
+    int len = recvfrom(sock, buf->data, bufferPool.blockSize, MSG_DONTWAIT, (struct sockaddr*) sourceAddr, socklen);
+    if (len <= 0)
+    {
+        bufferPool_Release(buf);
+        return NULL;
+    }
+    buf->len = len;
+    return buf;
+}
+
+
+/**
+    @brief  Answer all queued stats queries
+    @param[in]  sock Stats socket
+    @return None
+*/
+static void serveStatsRequests(int sock)
+{
+    uint8_t request[16];
+    uint8_t response[BRIDGE_STATS_HEADER_SIZE + 4 * BridgeStat_Count];
+    struct sockaddr_storage sourceAddr;
+    socklen_t socklen;
+    int len;
+
+    while (1)
+    {
+        socklen = sizeof(sourceAddr);
+        len = recvfrom(sock, request, sizeof(request), MSG_DONTWAIT, (struct sockaddr*) &sourceAddr, &socklen);
+        if (len <= 0)
+            break;
+        uint32_t uptimeMs = (uint32_t)((hal_GetTimeUs() - bridgeStartTime) / 1000);
+        uint32_t responseLen = bridgeStats_HandleRequest(request, len, response, sizeof(response), uptimeMs);
+        if (responseLen > 0)
+            sendto(sock, response, responseLen, 0, (struct sockaddr*) &sourceAddr, socklen);
+    }
+}
+
+
+/**
+    @brief  Compress downlink frames into downlinkEncoded, a key datagram is sent at least every TELEMETRY_CODEC_KEY_INTERVAL
+            and early for a new subscriber or new sensors, but not more often than TELEMETRY_CODEC_MIN_KEY_INTERVAL
+    @param[in]  spans Spans returned by xFifo_GetReadSpans()
+    @param[in]  len Number of bytes of whole frames to encode, up to TELEMETRY_CODEC_DATAGRAM_SIZE
+    @return Encoded datagram length
+*/
+static uint32_t encodeTelemetryDatagram(const xFifo_Span_t spans[2], uint32_t len)
+{
+    uint8_t frame[SPORT_MAX_RAW_FRAME_SIZE];
+    int64_t now = hal_GetTimeUs();
+    uint32_t encodedLen;
+    uint32_t pos = 0;
+
+    int64_t sinceKey = now - downlinkKeyTime;
+    bool isKeyWanted = isDownlinkKeyWanted || sportEncoder_HasNewSlots(&downlinkEncoder);
+    if ((sinceKey >= TELEMETRY_CODEC_KEY_INTERVAL * 1000ll) ||
+        (isKeyWanted && (sinceKey >= TELEMETRY_CODEC_MIN_KEY_INTERVAL * 1000ll)))
+        sportEncoder_Reset(&downlinkEncoder);
+    if (downlinkEncoder.isKeyPending)
+    {
+        downlinkKeyTime = now;
+        isDownlinkKeyWanted = false;
+    }
+    encodedLen = sportEncoder_Begin(&downlinkEncoder, downlinkEncoded);
+    while (pos < len)
+    {
+        // Frame ends at the next start byte, only a frame cut by eviction may not begin with one
+        uint32_t frameLen = 0;
+        do
+        {
+            frame[frameLen++] = spanByteAt(spans, pos++);
+        } while ((pos < len) && (frameLen < sizeof(frame)) && (spanByteAt(spans, pos) != SPORT_START_BYTE));
+        encodedLen += sportEncoder_PutFrame(&downlinkEncoder, frame, frameLen, &downlinkEncoded[encodedLen]);
+    }
+
+    bridgeStats_Add(BridgeStat_DownlinkCodecRawBytes, len);
+    bridgeStats_Add(BridgeStat_DownlinkCodecBytes, encodedLen);
+    bridgeStats_Set(BridgeStat_DownlinkCodecKeys, downlinkEncoder.stats.keys);
+    bridgeStats_Set(BridgeStat_DownlinkCodecLiterals, downlinkEncoder.stats.literals);
+    return encodedLen;
+}
+
+
+/**
+    @brief  Send single downlink datagram from smartPortDownlinkFifo
+            Datagram holds up to TELEMETRY_DATAGRAM_SIZE bytes of whole SmartPort frames, or
+            TELEMETRY_CODEC_DATAGRAM_SIZE bytes compressed into downlinkEncoded if enabled. If the producer may evict data
+            (DOWNLINK_EVICTS), the frames are copied out and consumed before sending, so
+            downlinkReadMutex is never held while sendmsg() blocks. Otherwise they are sent
+            directly from FIFO storage and consumed after sending.
+    @param[in]  sock Socket to use
+    @param[in]  dstAddr Destination addresses, the same datagram is sent to each of them
+    @param[in]  dstCount Number of destinations
+    @return Number of bytes consumed from the FIFO
+*/
+static uint32_t sendTelemetryDatagram(int sock, const struct sockaddr_in *dstAddr, uint32_t dstCount)
+{
+    xFifo_Span_t spans[2];
+    if (DOWNLINK_EVICTS)
+        hal_MutexLock(downlinkReadMutex);
+    uint32_t availCnt = xFifo_GetReadSpans(&smartPortDownlinkFifo, spans);
+    uint32_t maxLen = bridgeSettings.isDownlinkCompressed ? TELEMETRY_CODEC_DATAGRAM_SIZE : TELEMETRY_DATAGRAM_SIZE;
+    uint32_t len = (availCnt > maxLen) ? maxLen : availCnt;
+    if (len < availCnt)
+    {
+        // FIFO holds whole frames only: cut datagram before the start of the frame that does not fit
+        uint32_t frameStart = len;
+        while ((frameStart > 0) && (spanByteAt(spans, frameStart) != SPORT_START_BYTE))
+            frameStart--;
+        if (frameStart > 0)
+            len = frameStart;
+    }
+    if (len == 0)
+    {
+        if (DOWNLINK_EVICTS)
+            hal_MutexUnlock(downlinkReadMutex);
+        return 0;
+    }
+
+    struct iovec iov[2];
+    iov[0].iov_len = (spans[0].count > len) ? len : spans[0].count;
+    iov[1].iov_len = len - iov[0].iov_len;
+    if (bridgeSettings.isDownlinkCompressed)
+    {
+        iov[0].iov_base = downlinkEncoded;
+        iov[0].iov_len = encodeTelemetryDatagram(spans, len);
+        iov[1].iov_len = 0;
+    }
+    else if (DOWNLINK_EVICTS)
+    {
+        memcpy(downlinkDatagram, spans[0].ptr, iov[0].iov_len);
+        memcpy(&downlinkDatagram[iov[0].iov_len], spans[1].ptr, iov[1].iov_len);
+        iov[0].iov_base = downlinkDatagram;
+        iov[0].iov_len = len;
+        iov[1].iov_len = 0;
+    }
+    else
+    {
+        iov[0].iov_base = spans[0].ptr;
+        iov[1].iov_base = spans[1].ptr;
+    }
+
+    // Datagram no longer refers to FIFO storage, let the producer evict while it is sent
+    bool isCopied = bridgeSettings.isDownlinkCompressed || DOWNLINK_EVICTS;
+    if (isCopied)
+    {
+        xFifo_CommitRead(&smartPortDownlinkFifo, len);
+        if (DOWNLINK_EVICTS)
+            hal_MutexUnlock(downlinkReadMutex);
+    }
+
+    struct msghdr msg = {
+        .msg_namelen = sizeof(*dstAddr),
+        .msg_iov = iov,
+        .msg_iovlen = (iov[1].iov_len > 0) ? 2 : 1,
+    };
+    uint32_t i;
+    for (i = 0; i < dstCount; i++)
+    {
+        msg.msg_name = (void *)&dstAddr[i];
+        int err = sendmsg(sock, &msg, 0);
+        if (err < 0)
+        {
+            bridgeStats_Inc(BridgeStat_DownlinkSendErrors);
+            DLOGE(TELEM_TAG, "Error occurred during sending: errno %d", errno);
+        }
+        else
+        {
+            bridgeStats_Inc(BridgeStat_DownlinkDatagrams);
+            bridgeStats_Add(BridgeStat_DownlinkBytes, iov[0].iov_len + iov[1].iov_len);
+            bootTiming_Mark(BootPhase_FirstDatagram);
+        }
+    }
+    if (!isCopied)
+        xFifo_CommitRead(&smartPortDownlinkFifo, len);
+    DLOGI(TELEM_TAG, "downlink %u bytes to %u destination(s)", len, dstCount);
+    return len;
+}
+
+
+/**
+    @brief  Copy data into FIFO write spans at offset
+    @param[in]  spans Spans returned by xFifo_GetWriteSpans()
+    @param[in]  offset Byte offset from the first free byte
+    @param[in]  data Data
+    @param[in]  len Number of bytes, must fit into spans
+    @return None
+*/
+static void spanCopyTo(const xFifo_Span_t spans[2], uint32_t offset, const uint8_t *data, uint32_t len)
+{
+    if (offset < spans[0].count)
+    {
+        uint32_t n = (len > spans[0].count - offset) ? spans[0].count - offset : len;
+        memcpy((uint8_t *)spans[0].ptr + offset, data, n);
+        data += n;
+        len -= n;
+        offset = 0;
+    }
+    else
+    {
+        offset -= spans[0].count;
+    }
+    if (len > 0)
+        memcpy((uint8_t *)spans[1].ptr + offset, data, len);
+}
+
+
+/**
+    @brief  Telemetry UART sink: put uplink datagram into smartPortUplinkFifo as a single record
+            Datagram is either queued as a whole or rejected, it is written to UART by telemetry_uplink_task
+    @param[in]  ctx Not used
+    @param[in]  buf Datagram
+    @return Datagram length if queued, 0 if rejected
+*/
+static uint32_t uplinkSink(void *ctx, bufferPool_Buffer_t *buf)
+{
+    xFifo_Span_t spans[2];
+    uint32_t len = buf->len;
+    uint8_t recordLen = len;
+
+    if ((len > TELEMETRY_UPLINK_MAX_DATAGRAM) || (xFifo_GetWriteSpans(&smartPortUplinkFifo, spans) < len + 1))
+    {
+        bridgeStats_Inc(BridgeStat_UplinkDatagramsRejected);
+        return 0;
+    }
+    spanCopyTo(spans, 0, &recordLen, 1);
+    spanCopyTo(spans, 1, buf->data, len);
+    xFifo_CommitWrite(&smartPortUplinkFifo, len + 1);
+    bridgeStats_Inc(BridgeStat_UplinkDatagramsQueued);
+    bridgeStats_Max(BridgeStat_UplinkFifoHighWater, xFifo_DataAvaliable(&smartPortUplinkFifo));
+    hal_SignalGive(uplinkSignal);
+    return len;
+}
+
+
+/**
+    @brief  Tell uplink datagram sender that its datagram was not queued
+    @param[in]  sock Socket to use
+    @param[in]  len Rejected datagram length
+    @param[in]  dstAddr Sender address
+    @param[in]  dstAddrLen Size of dstAddr
+    @return None
+*/
+static void sendUplinkNak(int sock, uint32_t len, const struct sockaddr *dstAddr, socklen_t dstAddrLen)
+{
+    uint8_t nak[TELEMETRY_UPLINK_NAK_SIZE];
+    uint32_t freeSpace = xFifo_FreeSpace(&smartPortUplinkFifo);
+
+    memcpy(nak, TELEMETRY_UPLINK_NAK_MAGIC, 4);
+    nak[4] = len >> 8;
+    nak[5] = len;
+    nak[6] = freeSpace >> 8;
+    nak[7] = freeSpace;
+    if (sendto(sock, nak, sizeof(nak), 0, dstAddr, dstAddrLen) < 0)
+        DLOGE(TELEM_TAG, "Error occurred during sending: errno %d", errno);
+}
+
+
+/**
+    @brief  Handle datagram received on TELEMETRY_PORT: subscription control or uplink data
+    @param[in]  sock Telemetry socket
+    @param[in,out]  subscribers Subscriber table
+    @param[in]  buf Datagram
+    @param[in]  sourceAddr Sender address
+    @param[in]  socklen Size of sourceAddr
+    @return None
+*/
+static void handleTelemetryDatagram(int sock, subscribers_t *subscribers, bufferPool_Buffer_t *buf,
+                                    const struct sockaddr_storage *sourceAddr, socklen_t socklen)
+{
+    const uint8_t *data = buf->data;
+    int len = buf->len;
+
+    bridgeStats_Inc(BridgeStat_UplinkDatagrams);
+    bridgeStats_Add(BridgeStat_UplinkBytes, len);
+
+    // Data received
+    if (sourceAddr->ss_family != PF_INET)
+    {
+        DLOGE(TELEM_TAG, "IPv6 is not supported");
+        return;
+    }
+    const struct sockaddr_in *sourceAddrIn = (const struct sockaddr_in* )sourceAddr;
+    uint32_t sourceIp = ntohl(sourceAddrIn->sin_addr.s_addr);
+
+    // Subscription control
+    if ((len == TELEMETRY_MAGIC_SIZE) && (memcmp(data, TELEMETRY_HELLO_MAGIC, TELEMETRY_MAGIC_SIZE) == 0))
+    {
+        subscribersResult_t result = subscribers_Touch(subscribers, sourceAddrIn, hal_GetTimeUs());
+        if (result == Subscribers_Added)
+        {
+            // Compressed downlink: new subscriber can decode from the next key on, it is sent early
+            // unless keys were forced just before (subscriber churn must not make every datagram a key)
+            isDownlinkKeyWanted = true;
+            bridgeStats_Inc(BridgeStat_SubscriberJoins);
+            bridgeStats_Set(BridgeStat_Subscribers, subscribers->count);
+            DLOGI(TELEM_TAG, "subscriber %u.%u.%u.%u:%u added",
+                  sourceIp >> 24, (sourceIp >> 16) & 0xFF, (sourceIp >> 8) & 0xFF, sourceIp & 0xFF,
+                  ntohs(sourceAddrIn->sin_port));
+        }
+        else if (result == Subscribers_TableFull)
+        {
+            bridgeStats_Inc(BridgeStat_SubscribersRejected);
+        }
+        return;
+    }
+    if ((len == TELEMETRY_MAGIC_SIZE) && (memcmp(data, TELEMETRY_BYE_MAGIC, TELEMETRY_MAGIC_SIZE) == 0))
+    {
+        if (subscribers_Remove(subscribers, sourceAddrIn))
+            bridgeStats_Set(BridgeStat_Subscribers, subscribers->count);
+        return;
+    }
+
+    // Data for receiver, rejected datagram is reported to its sender
+    if (router_Forward(Channel_TelemetryUdp, buf))
+    {
+        DLOGI(TELEM_TAG, "uplink %d bytes from %u.%u.%u.%u", len,
+              sourceIp >> 24, (sourceIp >> 16) & 0xFF, (sourceIp >> 8) & 0xFF, sourceIp & 0xFF);
+    }
+    else
+    {
+        sendUplinkNak(sock, len, (const struct sockaddr*) sourceAddr, socklen);
+        DLOGD(TELEM_TAG, "uplink %d bytes from %u.%u.%u.%u rejected", len,
+              sourceIp >> 24, (sourceIp >> 16) & 0xFF, (sourceIp >> 8) & 0xFF, sourceIp & 0xFF);
+    }
+}
+
+
+static void telemetry_server_task(void *pvParameters)
+{
+    // Downlink goes to subscribers, or to downlinkAddr if there are none
+    struct sockaddr_in bcastAddr;
+    bcastAddr.sin_addr.s_addr = bridgeSettings.downlinkAddr;
+    bcastAddr.sin_family = AF_INET;
+    bcastAddr.sin_port = htons(TELEMETRY_PORT);
+
+    struct sockaddr_in mcastAddr;
+    mcastAddr.sin_addr.s_addr = bridgeSettings.multicastAddr;
+    mcastAddr.sin_family = AF_INET;
+    mcastAddr.sin_port = htons(TELEMETRY_PORT);
+
+    subscribers_t subscribers;
+    subscribers_Init(&subscribers);
+
+    struct sockaddr_storage sourceAddr;        // Large enough for both IPv4 or IPv6
+    socklen_t socklen;
+
+    bool isHolding = false;                     // Downlink data is waiting for coalescing
+    int64_t holdStartTime = 0;                  // [us]
+    int64_t holdTime = TELEMETRY_MAX_HOLD_TIME * 1000;      // Same for compressed downlink, it adds no latency
+    uint32_t datagramSize = bridgeSettings.isDownlinkCompressed ? TELEMETRY_CODEC_DATAGRAM_SIZE : TELEMETRY_DATAGRAM_SIZE;
+
+    createDoorbell(&telemetryDoorbell, TELEM_TAG);
+    int statsSock = createBoundSocket(STATS_PORT, false, TELEM_TAG);
+
+    while(1)
+    {
+        int sock = createBoundSocket(TELEMETRY_PORT, true, TELEM_TAG);
+        if (sock < 0)
+        {
+            hal_DelayMs(1000);
+            continue;
+        }
+        // Data buffered during boot is sent at once
+        atomic_store(&telemetryDownlinkFlush, true);
+        bootTiming_Mark(BootPhase_SocketBound);
+
+        while (1)
+        {
+            // Downink (to PC), coalesced into datagrams of datagramSize
+            bool flush = atomic_exchange(&telemetryDownlinkFlush, false);
+            int64_t now = hal_GetTimeUs();
+            uint32_t expired = subscribers_Expire(&subscribers, now, TELEMETRY_SUBSCRIBER_TIMEOUT * 1000ll);
+            if (expired > 0)
+            {
+                bridgeStats_Add(BridgeStat_SubscriberExpiries, expired);
+                bridgeStats_Set(BridgeStat_Subscribers, subscribers.count);
+                DLOGI(TELEM_TAG, "%u subscriber(s) expired, %u left", expired, subscribers.count);
+            }
+            const struct sockaddr_in *dstAddr = subscribers.addr;
+            uint32_t dstCount = subscribers.count;
+            if (dstCount == 0)
+            {
+                dstAddr = &bcastAddr;
+                dstCount = 1;
+            }
+            else if (mcastAddr.sin_addr.s_addr != 0)
+            {
+                dstAddr = &mcastAddr;
+                dstCount = 1;
+            }
+            uint32_t availCnt = xFifo_DataAvaliable(&smartPortDownlinkFifo);
+            if ((availCnt > 0) && !isHolding)
+            {
+                isHolding = true;
+                holdStartTime = now;
+            }
+            if (isHolding && (now - holdStartTime >= holdTime))
+                flush = true;
+            while ((availCnt >= datagramSize) || (flush && (availCnt > 0)))
+            {
+                sendTelemetryDatagram(sock, dstAddr, dstCount);
+                availCnt = xFifo_DataAvaliable(&smartPortDownlinkFifo);
+            }
+            if (availCnt == 0)
+                isHolding = false;
+
+            // Uplink (from PC), all queued datagrams
+            bufferPool_Buffer_t *buf;
+            while ((buf = receiveDatagram(sock, &sourceAddr, &socklen)) != NULL)
+            {
+                handleTelemetryDatagram(sock, &subscribers, buf, &sourceAddr, socklen);
+                bufferPool_Release(buf);
+            }
+
+            // Sleep until downlink data is notified, uplink datagram or stats query arrives
+            fd_set readSet;
+            FD_ZERO(&readSet);
+            FD_SET(sock, &readSet);
+            int maxFd = sock;
+            addToReadSet(telemetryDoorbell.rxSock, &readSet, &maxFd);
+            addToReadSet(statsSock, &readSet, &maxFd);
+            // Held data must be sent not later than holdTime after it was noticed
+            int64_t timeout = TELEMETRY_SERVER_IDLE_TIMEOUT * 1000;
+            if (isHolding)
+            {
+                timeout = holdStartTime + holdTime - hal_GetTimeUs();
+                if (timeout < 0)
+                    timeout = 0;
+            }
+            struct timeval tv = {
+                .tv_sec = timeout / 1000000,
+                .tv_usec = timeout % 1000000,
+            };
+            int ready = select(maxFd + 1, &readSet, NULL, NULL, &tv);
+            if (ready < 0)
+            {
+                HAL_LOGE(TELEM_TAG, "select() failed: errno %d", errno);
+                hal_DelayMs(10);
+            }
+            if ((ready > 0) && (telemetryDoorbell.rxSock >= 0) && FD_ISSET(telemetryDoorbell.rxSock, &readSet))
+                rearmDoorbell(&telemetryDoorbell);
+            if ((ready > 0) && (statsSock >= 0) && FD_ISSET(statsSock, &readSet))
+                serveStatsRequests(statsSock);
+        }
+    }
+}
+
+
+/**
+    @brief  Set baud rate of UART link
+    @param[in]  link Index into uartLinks
+    @param[in]  baudRate Baud rate
+    @return True if baud rate is set
+*/
+static bool setLinkBaudRate(uint32_t link, uint32_t baudRate)
+{
+    const uartLink_t *l = &uartLinks[link];
+
+    if (!hal_UartSetBaudRate(l->config.port, baudRate))
+        return false;
+    // Data received at the old rate is garbage at the new one
+    hal_UartFlushInput(l->config.port);
+    bridgeStats_Set(l->statBaudRate, baudRate);
+    bridgeStats_Inc(BridgeStat_BaudRateChanges);
+    return true;
+}
+
+
+/**
+    @brief  Switch UART link to the current autobaud candidate rate and start checking received data
+            Candidates not supported by the platform are skipped
+    @param[in]  link Index into uartLinks
+    @return None
+*/
+static void tryAutobaudCandidate(uint32_t link)
+{
+    const uartLink_t *l = &uartLinks[link];
+    uartLinkState_t *st = &uartLinkStates[link];
+    uint32_t i;
+
+    for (i = 0; i < AUTOBAUD_RATE_COUNT; i++)
+    {
+        if (setLinkBaudRate(link, autobaudRates[st->candidate]))
+            break;
+        st->candidate = (st->candidate + 1) % AUTOBAUD_RATE_COUNT;
+    }
+    st->goodStart = bridgeStats_Get(l->statAutobaudGood);
+    st->badStart = bridgeStats_Get(l->statAutobaudBad);
+    timerService_ArmIn(&st->autobaudTimer, UART_AUTOBAUD_DWELL_TIME);
+}
+
+
+/**
+    @brief  Start autobaud, the current rate is tried first
+    @param[in]  link Index into uartLinks
+    @return None
+*/
+static void startAutobaud(uint32_t link)
+{
+    uartLinkState_t *st = &uartLinkStates[link];
+    uint32_t baudRate = hal_UartGetBaudRate(uartLinks[link].config.port);
+
+    st->autobaud = BridgeAutobaud_Searching;
+    st->candidate = 0;
+    while ((st->candidate < AUTOBAUD_RATE_COUNT - 1) && (autobaudRates[st->candidate] != baudRate))
+        st->candidate++;
+    if (autobaudRates[st->candidate] != baudRate)
+        st->candidate = 0;
+    tryAutobaudCandidate(link);
+}
+
+
+/**
+    @brief  Check data received at autobaud candidate rate, called by config_server_task after UART_AUTOBAUD_DWELL_TIME
+            Rate is locked if enough valid data and few errors were received, otherwise the next candidate is tried
+    @param[in]  link Index into uartLinks
+    @return None
+*/
+static void checkAutobaudCandidate(uint32_t link)
+{
+    const uartLink_t *l = &uartLinks[link];
+    uartLinkState_t *st = &uartLinkStates[link];
+
+    // Fixed rate or autobaud restart was requested after the timer expired
+    if ((st->autobaud != BridgeAutobaud_Searching) || timerService_IsArmed(&st->autobaudTimer))
+        return;
+    uint32_t good = bridgeStats_Get(l->statAutobaudGood) - st->goodStart;
+    uint32_t bad = bridgeStats_Get(l->statAutobaudBad) - st->badStart;
+    if ((good >= l->autobaudMinGood) && (bad * 4 < good))
+    {
+        st->autobaud = BridgeAutobaud_Locked;
+        bridgeStats_Inc(BridgeStat_AutobaudLocks);
+        DLOGI(l->tag, "autobaud locked at %u", autobaudRates[st->candidate]);
+    }
+    else
+    {
+        st->candidate = (st->candidate + 1) % AUTOBAUD_RATE_COUNT;
+        tryAutobaudCandidate(link);
+    }
+}
+
+
+/**
+    @brief  Autobaud dwell time expired, called by timer service
+            Changing the baud rate and flushing the UART are left to config_server_task,
+            so the timer service never waits for them
+    @param[in]  arg Index into uartLinks
+    @return None
+*/
+static void autobaudTimeout(void *arg)
+{
+    atomic_fetch_or(&autobaudDueLinks, 1u << (uint32_t)(uintptr_t)arg);
+    ringDoorbell(&configDoorbell);
+}
+
+
+/**
+    @brief  Answer baud rate request received on CONFIG_PORT, see BRIDGE_BAUD_MAGIC
+    @param[in]  sock Config socket
+    @param[in]  buf Request
+    @param[in]  sourceAddr Sender address
+    @param[in]  socklen Size of sourceAddr
+    @return None
+*/
+static void handleBaudRequest(int sock, const bufferPool_Buffer_t *buf, const struct sockaddr_storage *sourceAddr,
+                              socklen_t socklen)
+{
+    uint8_t reply[BRIDGE_BAUD_REPLY_SIZE];
+    uint32_t link = buf->data[4];
+    uint32_t requestedRate = ((uint32_t)buf->data[5] << 24) | ((uint32_t)buf->data[6] << 16) |
+                             ((uint32_t)buf->data[7] << 8) | buf->data[8];
+    bridgeBaudStatus_t status = BridgeBaud_Ok;
+    bridgeAutobaud_t autobaud = BridgeAutobaud_Off;
+    uint32_t baudRate = 0;
+
+    // UART that could not be opened reports no baud rate
+    if ((link >= UART_LINK_COUNT) || (hal_UartGetBaudRate(uartLinks[link].config.port) == 0))
+    {
+        status = BridgeBaud_InvalidLink;
+    }
+    else
+    {
+        uartLinkState_t *st = &uartLinkStates[link];
+        if (requestedRate == BRIDGE_BAUD_AUTO)
+        {
+            startAutobaud(link);
+        }
+        else if (requestedRate != BRIDGE_BAUD_QUERY)
+        {
+            if (setLinkBaudRate(link, requestedRate))
+            {
+                st->autobaud = BridgeAutobaud_Off;
+                timerService_Cancel(&st->autobaudTimer);
+            }
+            else
+            {
+                status = BridgeBaud_UnsupportedRate;
+            }
+        }
+        autobaud = st->autobaud;
+        baudRate = hal_UartGetBaudRate(uartLinks[link].config.port);
+        DLOGI(uartLinks[link].tag, "baud request %u: status %d, rate %u", requestedRate, status, baudRate);
+    }
+
+    memcpy(reply, BRIDGE_BAUD_MAGIC, 4);
+    reply[4] = link;
+    reply[5] = status;
+    reply[6] = autobaud;
+    reply[7] = baudRate >> 24;
+    reply[8] = baudRate >> 16;
+    reply[9] = baudRate >> 8;
+    reply[10] = baudRate;
+    if (sendto(sock, reply, sizeof(reply), 0, (const struct sockaddr*) sourceAddr, socklen) < 0)
+        DLOGE(CONFIG_TAG, "Error occurred during sending: errno %d", errno);
+}
+
+
+/**
+    @brief  Enter AAT configuration mode or prolong it, called by config_server_task
+            Telemetry route to AAT UART is disabled until AAT_CONFIG_TIMEOUT expires
+    @return None
+*/
+static void activateAatConfigMode(void)
+{
+    if (!(router_SetFlags(ROUTE_FLAG_AAT_CONFIG_MODE) & ROUTE_FLAG_AAT_CONFIG_MODE))
+    {
+        aatConfigModeStartTime = hal_GetTimeUs();
+        bridgeStats_Inc(BridgeStat_ConfigModeEntries);
+        putLedIndication(AatModeTelemLed, LedIndic_Off, 0, 0, 0);
+        putLedIndication(AatModeConfigLed, LedIndic_On, 0, 0, 0);
+    }
+    putAltLedIndication(AatModeConfigLed, LedIndic_Blink, 10, 40, 1);
+    timerService_ArmIn(&aatConfigModeTimer, AAT_CONFIG_TIMEOUT);
+}
+
+
+/**
+    @brief  Leave AAT configuration mode, called by config_server_task after AAT_CONFIG_TIMEOUT expired
+            Mode is changed by config_server_task only, so it is never left just after it was prolonged
+    @return None
+*/
+static void leaveAatConfigMode(void)
+{
+    // Configurator data arrived and prolonged the mode after the timer expired
+    if (timerService_IsArmed(&aatConfigModeTimer) || !(router_GetFlags() & ROUTE_FLAG_AAT_CONFIG_MODE))
+        return;
+    router_ClearFlags(ROUTE_FLAG_AAT_CONFIG_MODE);
+    bridgeStats_Add(BridgeStat_ConfigModeTime, (uint32_t)((hal_GetTimeUs() - aatConfigModeStartTime) / 1000));
+    putLedIndication(AatModeTelemLed, LedIndic_On, 0, 0, 0);
+    putLedIndication(AatModeConfigLed, LedIndic_Off, 0, 0, 0);
+}
+
+
+/**
+    @brief  AAT configuration mode timeout expired, called by timer service
+    @param[in]  arg Not used
+    @return None
+*/
+static void aatConfigModeTimeout(void *arg)
+{
+    atomic_store(&isAatConfigModeExpired, true);
+    ringDoorbell(&configDoorbell);
+}
+
+
+/**
+    @brief  Handle timers expired for config_server_task: config mode timeout and autobaud dwell time
+    @return None
+*/
+static void handleConfigTimers(void)
+{
+    uint32_t dueLinks = atomic_exchange(&autobaudDueLinks, 0);
+    uint32_t link;
+
+    if (atomic_exchange(&isAatConfigModeExpired, false))
+        leaveAatConfigMode();
+    for (link = 0; link < UART_LINK_COUNT; link++)
+    {
+        if (dueLinks & (1u << link))
+            checkAutobaudCandidate(link);
+    }
+}
+
+
+/**
+    @brief  UART sink: write data into UART driver TX buffer
+            Data is copied rather than queued by reference: the driver write copies it into its TX
+            ring anyway, and the block returns to the pool at once instead of for the UART send time
+    @param[in]  ctx Pointer to UART port number
+    @param[in]  buf Data
+    @return Number of bytes accepted by driver
+*/
+static uint32_t uartSink(void *ctx, bufferPool_Buffer_t *buf)
+{
+    int written = hal_UartWrite(*(const int *)ctx, buf->data, buf->len);
+    return (written > 0) ? written : 0;
+}
+
+
+/**
+    @brief  Config UDP sink: queue AAT data buffer into configDownlinkFifo and wake config_server_task
+            Buffer is queued by reference, it is dropped if the queue is full
+    @param[in]  ctx Not used
+    @param[in]  buf Data
+    @return Number of bytes queued
+*/
+static uint32_t configDownlinkSink(void *ctx, bufferPool_Buffer_t *buf)
+{
+    bufferPool_Ref(buf);
+    if (xFifo_Put(&configDownlinkFifo, &buf, 1) == 0)
+    {
+        bufferPool_Release(buf);
+        return 0;
+    }
+    ringDoorbell(&configDoorbell);
+    return buf->len;
+}
+
+
+/**
+    @brief  Send queued AAT data to configurator, one datagram per buffer
+    @param[in]  sock Socket to use
+    @param[in]  dstAddr Configurator address, NULL if not known yet - data is dropped
+    @return None
+*/
+static void sendConfigDownlink(int sock, const struct sockaddr_in *dstAddr)
+{
+    bufferPool_Buffer_t *buf;
+
+    while (xFifo_Get(&configDownlinkFifo, &buf, 1) > 0)
+    {
+        if (!dstAddr)
+        {
+            bridgeStats_Add(BridgeStat_ConfigDownlinkDroppedBytes, buf->len);
+        }
+        else if (sendto(sock, buf->data, buf->len, 0, (struct sockaddr*) dstAddr, sizeof(*dstAddr)) < 0)
+        {
+            bridgeStats_Inc(BridgeStat_ConfigDownlinkSendErrors);
+            DLOGE(CONFIG_TAG, "Error occurred during sending: errno %d", errno);
+        }
+        else
+        {
+            bridgeStats_Inc(BridgeStat_ConfigDownlinkDatagrams);
+            bridgeStats_Add(BridgeStat_ConfigDownlinkBytes, buf->len);
+            DLOGI(CONFIG_TAG, "downlink %u bytes", buf->len);
+
+            // Disable telemetry UART sending to AAT
+            activateAatConfigMode();
+        }
+        bufferPool_Release(buf);
+    }
+}
+
+
+static void config_server_task(void *pvParameters)
+{
+    char addrStr[128];
+    int isClientAddrKnown = 0;
+
+    struct sockaddr_in clientAddr;
+    struct sockaddr_storage sourceAddr;        // Large enough for both IPv4 or IPv6
+    socklen_t socklen;
+
+    createDoorbell(&configDoorbell, CONFIG_TAG);
+
+    while(1)
+    {
+        int sock = createBoundSocket(CONFIG_PORT, false, CONFIG_TAG);
+        if (sock < 0)
+        {
+            hal_DelayMs(1000);
+            continue;
+        }
+
+        while (1)
+        {
+            handleConfigTimers();
+
+            // Downlink (to PC), data received before configurator is known is dropped
+            sendConfigDownlink(sock, isClientAddrKnown ? &clientAddr : NULL);
+
+            // Uplink (from PC), all queued datagrams
+            bufferPool_Buffer_t *buf;
+            while ((buf = receiveDatagram(sock, &sourceAddr, &socklen)) != NULL)
+            {
+                if (sourceAddr.ss_family != PF_INET)
+                {
+                    DLOGE(CONFIG_TAG, "IPv6 is not supported");
+                    bufferPool_Release(buf);
+                    continue;
+                }
+                // Bridge control, not forwarded to AAT
+                if ((buf->len == BRIDGE_BAUD_REQUEST_SIZE) && (memcmp(buf->data, BRIDGE_BAUD_MAGIC, 4) == 0))
+                {
+                    handleBaudRequest(sock, buf, &sourceAddr, socklen);
+                    bufferPool_Release(buf);
+                    continue;
+                }
+                DLOGI(CONFIG_TAG, "uplink %u bytes", buf->len);
+                bridgeStats_Inc(BridgeStat_ConfigUplinkDatagrams);
+                bridgeStats_Add(BridgeStat_ConfigUplinkBytes, buf->len);
+                // Downlink goes to the last configurator that has sent data
+                clientAddr = *(struct sockaddr_in* )&sourceAddr;
+                if (!isClientAddrKnown)
+                {
+                    isClientAddrKnown = 1;
+                    inet_ntoa_r(clientAddr.sin_addr, addrStr, sizeof(addrStr) - 1);
+                    HAL_LOGI(CONFIG_TAG, "Client address: %s", addrStr);
+                }
+                // Disable telemetry UART sending to AAT
+                activateAatConfigMode();
+                router_Forward(Channel_ConfigUdp, buf);
+                bufferPool_Release(buf);
+            }
+
+            // Sleep until AAT data or an expired timer is notified or uplink datagram arrives
+            fd_set readSet;
+            FD_ZERO(&readSet);
+            FD_SET(sock, &readSet);
+            int maxFd = sock;
+            addToReadSet(configDoorbell.rxSock, &readSet, &maxFd);
+            int ready = select(maxFd + 1, &readSet, NULL, NULL, NULL);
+            if (ready < 0)
+            {
+                HAL_LOGE(CONFIG_TAG, "select() failed: errno %d", errno);
+                hal_DelayMs(10);
+            }
+            if ((ready > 0) && (configDoorbell.rxSock >= 0) && FD_ISSET(configDoorbell.rxSock, &readSet))
+                rearmDoorbell(&configDoorbell);
+        }
+    }
+}
+
+
+/**
+    @brief  Check telemetry UART data loss, called by timer service
+            Re-armed for TELEMETRY_TIMEOUT after the last reception instead of on each reception,
+            so telemetry_mux_task does not touch the timer while data is coming
+    @param[in]  arg Not used
+    @return None
+*/
+static void telemetryTimeout(void *arg)
+{
+    uint32_t idleTime = (uint32_t)hal_GetTimeUs() - atomic_load(&telemetryLastRxTime);
+    if (idleTime < TELEMETRY_TIMEOUT * 1000)
+    {
+        timerService_ArmIn(&telemetryTimeoutTimer, TELEMETRY_TIMEOUT - idleTime / 1000);
+        return;
+    }
+    atomic_store(&isTelemetryLost, true);
+    bridgeStats_Inc(BridgeStat_TelemetryTimeouts);
+    DLOGW(TELEM_TAG, "no telemetry UART data for %u ms", TELEMETRY_TIMEOUT);
+    //putLedIndication(TelemLed, LedIndic_Blink, 1000, 1000, 0);
+}
+
+
+/**
+    @brief  Evict oldest downlink data until there is room for a new frame
+            FIFO holds whole frames, each begins with the only SPORT_START_BYTE in it
+    @param[in]  needed Free space needed [bytes], up to FIFO size
+    @return None
+*/
+static void evictDownlinkData(uint32_t needed)
+{
+    xFifo_Span_t spans[2];
+    uint32_t evicted = 0;
+    uint32_t frames = 0;
+
+    hal_MutexLock(downlinkReadMutex);
+    uint32_t availCnt = xFifo_GetReadSpans(&smartPortDownlinkFifo, spans);
+    uint32_t freeSpace = smartPortDownlinkFifo.size - availCnt;
+    if (TELEMETRY_DOWNLINK_OVERFLOW_POLICY == OverflowPolicy_DropOldest)
+    {
+        evicted = (needed > freeSpace) ? needed - freeSpace : 0;
+    }
+    else
+    {
+        while ((freeSpace + evicted < needed) && (evicted < availCnt))
+        {
+            evicted++;
+            while ((evicted < availCnt) && (spanByteAt(spans, evicted) != SPORT_START_BYTE))
+                evicted++;
+            frames++;
+        }
+    }
+    xFifo_CommitRead(&smartPortDownlinkFifo, evicted);
+    hal_MutexUnlock(downlinkReadMutex);
+
+    bridgeStats_Add(BridgeStat_DownlinkEvictedBytes, evicted);
+    bridgeStats_Add(BridgeStat_DownlinkEvictedFrames, frames);
+}
+
+
+/**
+    @brief  Telemetry UDP sink: put whole valid SmartPort frames into smartPortDownlinkFifo
+            Corrupt frames are dropped here and never use WiFi airtime
+            Frames are copied rather than queued by reference: they are reassembled across reads,
+            and the FIFO packs frames of many reads into one datagram sent without another copy.
+            Holding the blocks for TELEMETRY_MAX_HOLD_TIME would exhaust the pool.
+    @param[in]  ctx Not used
+    @param[in]  buf Raw telemetry UART data
+    @return Number of bytes, they are always consumed by the decoder
+*/
+static uint32_t sportDownlinkSink(void *ctx, bufferPool_Buffer_t *buf)
+{
+    uint32_t framesPut = 0;
+    uint32_t i;
+
+    for (i = 0; i < buf->len; i++)
+    {
+        if (sportDecoder_PutByte(&telemetryDecoder, buf->data[i]) == SportDecoder_Frame)
+        {
+            // Frames are never split in the FIFO, on overflow the newest or the oldest data is dropped
+            uint32_t rawLen = telemetryDecoder.rawLen;
+            if (DOWNLINK_EVICTS && (xFifo_FreeSpace(&smartPortDownlinkFifo) < rawLen))
+                evictDownlinkData(rawLen);
+            if (xFifo_FreeSpace(&smartPortDownlinkFifo) >= rawLen)
+            {
+                xFifo_Put(&smartPortDownlinkFifo, telemetryDecoder.raw, telemetryDecoder.rawLen);
+                framesPut++;
+            }
+            else
+            {
+                bridgeStats_Inc(BridgeStat_DownlinkFramesDropped);
+            }
+        }
+    }
+
+    if (framesPut > 0)
+    {
+        bridgeStats_Add(BridgeStat_DownlinkFramesQueued, framesPut);
+        bridgeStats_Max(BridgeStat_DownlinkFifoHighWater, xFifo_DataAvaliable(&smartPortDownlinkFifo));
+        ringDoorbell(&telemetryDoorbell);
+    }
+    return buf->len;
+}
+
+
+/**
+    @brief  Telemetry UART link activity: loss detection, indication, downlink flush and uplink slots
+    @param[in]  readBytes Number of bytes read and forwarded
+    @param[in]  isLineIdle Line is idle after the read data
+    @return None
+*/
+static void telemetryAfterRead(uint32_t readBytes, bool isLineIdle)
+{
+    if (readBytes > 0)
+    {
+        bootTiming_Mark(BootPhase_FirstUartData);
+        atomic_store(&telemetryLastRxTime, (uint32_t)hal_GetTimeUs());
+
+        // Timeout timer re-arms itself while data keeps coming, it is restarted here after a loss only
+        if (atomic_exchange(&isTelemetryLost, false))
+        {
+            timerService_ArmIn(&telemetryTimeoutTimer, TELEMETRY_TIMEOUT);
+            DLOGI(TELEM_TAG, "telemetry UART data restored");
+        }
+
+        // Indicate
+        putAltLedIndication(TelemLed, LedIndic_Blink, 10, 40, 1);
+
+        // Output to AAT UART is disabled during configuration of AAT
+        if (!(router_GetFlags() & ROUTE_FLAG_AAT_CONFIG_MODE))
+            putAltLedIndication(AatModeTelemLed, LedIndic_Blink, 10, 40, 1);
+
+        // Decoder is owned by telemetry UART reader, its counters are mirrored
+        bridgeStats_Set(BridgeStat_SportFrames, telemetryDecoder.stats.frames);
+        bridgeStats_Set(BridgeStat_SportPolls, telemetryDecoder.stats.polls);
+        bridgeStats_Set(BridgeStat_SportCrcErrors, telemetryDecoder.stats.crcErrors);
+        bridgeStats_Set(BridgeStat_SportFramingErrors, telemetryDecoder.stats.framingErrors);
+    }
+
+    if (!isLineIdle)
+        return;
+
+    // Line is idle - do not wait for coalescing of downlink datagram
+    if (xFifo_DataAvaliable(&smartPortDownlinkFifo) > 0)
+    {
+        atomic_store(&telemetryDownlinkFlush, true);
+        ringDoorbell(&telemetryDoorbell);
+    }
+
+    // Line is idle after a poll of the uplink physical ID - the slot is free for uplink data
+    uint8_t physId;
+    if ((xFifo_DataAvaliable(&smartPortUplinkFifo) > 0) &&
+        sportDecoder_IsPollPending(&telemetryDecoder, &physId) && (physId == TELEMETRY_UPLINK_PHYS_ID))
+    {
+        atomic_store(&uplinkSlotTime, (uint32_t)hal_GetTimeUs());
+        atomic_store(&uplinkSlotOpen, true);
+        hal_SignalGive(uplinkSignal);
+    }
+}
+
+
+/**
+    @brief  Read UART link and forward all buffered data from its channel
+    @param[in]  pvParameters UART link, see uartLinks
+    @return None
+*/
+static void uart_reader_task(void *pvParameters)
+{
+    const uartLink_t *link = (const uartLink_t *)pvParameters;
+    const int port = link->config.port;
+    const int bufSize = bufferPool.blockSize;
+    hal_UartEvent_t event;
+    bool isDataLeft = false;                    // Previous read stopped on exhausted pool
+
+    while(1)
+    {
+        // Sleep until UART driver reports data (RX FIFO threshold or line idle) or an error.
+        // Data left in the driver is read again after BUFFER_POOL_WAIT_TIME even if the sender
+        // went quiet - no event would come for it then.
+        if (!hal_UartWaitEvent(port, &event, isDataLeft ? BUFFER_POOL_WAIT_TIME : HAL_WAIT_FOREVER))
+        {
+            if (!isDataLeft || (hal_UartAvailable(port) <= 0))
+            {
+                isDataLeft = false;
+                continue;
+            }
+            // No event for the wait time: line is idle after the data left
+            event.type = HalUartEvent_Data;
+            event.lineIdle = true;
+        }
+
+        switch (event.type)
+        {
+            case HalUartEvent_Data:
+                break;
+            case HalUartEvent_Overflow:
+                // Data already buffered by the driver is valid, forward it as usual
+                bridgeStats_Inc(link->statOverflows);
+                DLOGW(link->tag, "UART overflow, total %u", bridgeStats_Get(link->statOverflows));
+                break;
+            case HalUartEvent_Break:
+                bridgeStats_Inc(link->statBreaks);
+                break;
+            case HalUartEvent_FrameError:
+                bridgeStats_Inc(link->statFrameErrors);
+                break;
+            default:
+                break;
+        }
+
+        // Several events may be covered by single read - all buffered data is forwarded at once
+        uint32_t readBytes = 0;
+        int availCnt = hal_UartAvailable(port);
+        while (availCnt > 0)
+        {
+            bufferPool_Buffer_t *buf = bufferPool_Alloc(&bufferPool);
+            if (!buf)
+            {
+                // Data stays in UART driver buffer until sinks release some blocks. If none is released
+                // in time, go back to the event wait - the rest is read with the next event or after
+                // BUFFER_POOL_WAIT_TIME.
+                if (bufferPool_WaitFree(&bufferPool, BUFFER_POOL_WAIT_TIME))
+                    continue;
+                break;
+            }
+            int len = (availCnt > bufSize) ? bufSize : availCnt;
+            len = hal_UartRead(port, buf->data, len);
+            if (len <= 0)
+            {
+                bufferPool_Release(buf);
+                break;
+            }
+            buf->len = len;
+            availCnt -= len;
+            readBytes += len;
+            bridgeStats_Add(link->statRxBytes, len);
+            router_Forward(link->channel, buf);
+            bufferPool_Release(buf);
+        }
+
+        // Line idle is reported only when everything before it was forwarded, otherwise the
+        // downlink would be flushed without the frames still in the driver
+        isDataLeft = (availCnt > 0);
+        if (link->afterRead)
+            link->afterRead(readBytes, (event.type == HalUartEvent_Data) && event.lineIdle && !isDataLeft);
+    }
+}
+
+
+/**
+    @brief  Write uplink datagrams from smartPortUplinkFifo to telemetry UART
+            SmartPort is half-duplex and driven by polls of the receiver, so one datagram is
+            written per free slot of TELEMETRY_UPLINK_PHYS_ID. If nothing is received for
+            TELEMETRY_UPLINK_SILENT_TIME, there is no bus master and datagrams are written at once.
+    @return None
+*/
+static void telemetry_uplink_task(void *pvParameters)
+{
+    uint8_t record[1 + TELEMETRY_UPLINK_MAX_DATAGRAM];
+
+    while(1)
+    {
+        if (xFifo_DataAvaliable(&smartPortUplinkFifo) == 0)
+        {
+            hal_SignalWait(uplinkSignal, HAL_WAIT_FOREVER);
+            continue;
+        }
+
+        // Slot that was not taken in time is lost, the next poll will open another one
+        uint32_t now = (uint32_t)hal_GetTimeUs();
+        bool isSlot = atomic_exchange(&uplinkSlotOpen, false) &&
+                      (now - atomic_load(&uplinkSlotTime) < TELEMETRY_UPLINK_SLOT_WINDOW * 1000);
+        bool isSilent = (now - atomic_load(&telemetryLastRxTime) >= TELEMETRY_UPLINK_SILENT_TIME * 1000);
+        if (!isSlot && !isSilent)
+        {
+            hal_SignalWait(uplinkSignal, TELEMETRY_UPLINK_SILENT_TIME);
+            continue;
+        }
+
+        // Records are put as a whole by uplinkSink()
+        xFifo_PeekAt(&smartPortUplinkFifo, &record[0], 0);
+        xFifo_Get(&smartPortUplinkFifo, record, 1 + record[0]);
+        int written = hal_UartWrite(TELEMETRY_UART, &record[1], record[0]);
+        if (written > 0)
+        {
+            bridgeStats_Inc(BridgeStat_UplinkUartDatagrams);
+            bridgeStats_Add(BridgeStat_UplinkUartBytes, written);
+        }
+        if (!isSlot)
+            bridgeStats_Inc(BridgeStat_UplinkUnpacedWrites);
+        DLOGD(TELEM_TAG, "uplink %d bytes written to UART", written);
+    }
+}
+
+
+/**
+    @brief  Init bridge data structures, open UARTs and start UART ingest
+            Does not need the network: telemetry is forwarded to AAT UART at once, and downlink
+            frames are buffered in smartPortDownlinkFifo until bridge_Start() binds the socket
+    @return None
+*/
+void bridge_Init(void)
+{
+    uint32_t i;
+
+    bridgeStartTime = hal_GetTimeUs();
+    dlog_Init();
+    timerService_Init();
+    ledIndication_Init();
+    timerService_InitTimer(&aatConfigModeTimer, aatConfigModeTimeout, NULL);
+    timerService_InitTimer(&telemetryTimeoutTimer, telemetryTimeout, NULL);
+    bufferPool_Init(&bufferPool, bufferPoolStorage, BUFFER_POOL_BLOCK_SIZE, BUFFER_POOL_BLOCK_COUNT,
+                    BridgeStat_BufferPoolExhausted, BridgeStat_BufferPoolHighWater);
+    xFifo_CreateStatic(&smartPortDownlinkFifo, sizeof(uint8_t), smartPortDownlinkStorage, sizeof(smartPortDownlinkStorage));
+    bridgeStats_Set(BridgeStat_DownlinkFifoSize, smartPortDownlinkFifo.size);
+    bridgeStats_Set(BridgeStat_DownlinkOverflowPolicy, TELEMETRY_DOWNLINK_OVERFLOW_POLICY);
+    downlinkReadMutex = hal_MutexCreate();
+    sportDecoder_Init(&telemetryDecoder);
+    xFifo_CreateStatic(&smartPortUplinkFifo, sizeof(uint8_t), smartPortUplinkStorage, sizeof(smartPortUplinkStorage));
+    uplinkSignal = hal_SignalCreate();
+    xFifo_CreateStatic(&configDownlinkFifo, sizeof(bufferPool_Buffer_t *), (uint8_t *)configDownlinkStorage,
+                       CONFIG_DOWNLINK_QUEUE_SIZE);
+
+    if (!router_Init(bridgeChannels, Channel_Count, bridgeRoutes, BRIDGE_ROUTE_COUNT))
+        HAL_LOGE(TELEM_TAG, "Invalid route table");
+
+    for (i = 0; i < UART_LINK_COUNT; i++)
+    {
+        const uartLink_t *l = &uartLinks[i];
+        timerService_InitTimer(&uartLinkStates[i].autobaudTimer, autobaudTimeout, (void *)(uintptr_t)i);
+        if (!hal_UartOpen(&l->config))
+        {
+            HAL_LOGE(l->tag, "Unable to open %s", bridgeChannels[l->channel].name);
+            continue;
+        }
+        bridgeStats_Set(l->statBaudRate, hal_UartGetBaudRate(l->config.port));
+        if (l->isAutobaudAtStart)
+            startAutobaud(i);
+    }
+
+    atomic_store(&telemetryLastRxTime, (uint32_t)hal_GetTimeUs());
+    timerService_ArmIn(&telemetryTimeoutTimer, TELEMETRY_TIMEOUT);
+
+    dlog_Start();
+    ledIndication_Start();
+    putLedIndication(AatModeTelemLed, LedIndic_On, 0, 0, 0);
+    putLedIndication(TelemLed, LedIndic_Blink, 1000, 1000, 0);
+    for (i = 0; i < UART_LINK_COUNT; i++)
+        hal_TaskCreate(uart_reader_task, uartLinks[i].taskName, 4096, (void *)&uartLinks[i], uartLinks[i].taskPriority);
+    hal_TaskCreate(telemetry_uplink_task, "telemetry_uplink", 3072, 0, 5);  // Below telemetry_mux, uplink writes never delay downlink
+    bootTiming_Mark(BootPhase_UartsReady);
+}
+
+
+/**
+    @brief  Timer service task, timers armed by bridge_Init() are handled from bridge_Start() on
+            None of them is boot critical
+    @param[in]  pvParameters Not used
+    @return None, never returns
+*/
+static void timer_service_task(void *pvParameters)
+{
+    timerService_Run();
+}
+
+
+/**
+    @brief  Start network tasks
+            Network interface must be ready
+    @param[in]  settings Network settings
+    @return None
+*/
+void bridge_Start(const bridgeSettings_t *settings)
+{
+    bridgeSettings = *settings;
+    sportEncoder_Init(&downlinkEncoder);
+
+    // Timer callbacks enforce deadlines of UART readers and servers, so the service runs above or with them
+    hal_TaskCreate(timer_service_task, "timer_service", 3072, 0, 6);
+    hal_TaskCreate(telemetry_server_task, "telemetry_server", 4096, 0, 4);
+    hal_TaskCreate(config_server_task, "config_server", 4096, 0, 5);
+}
+
+
+/**
+    @brief  Block calling task, bridge runs in its own tasks. Must be called after bridge_Start()
+    @return None, never returns
+*/
+void bridge_Run(void)
+{
+    hal_Signal_t never = hal_SignalCreate();
+    while (1)
+        hal_SignalWait(never, HAL_WAIT_FOREVER);
+}
@@ -0,0 +1,59 @@
+/**
+    @file
+    @brief   UART <-> UDP bridge logic
+*/
+
+#ifndef __BRIDGE_H__
+#define __BRIDGE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Reply to uplink datagram that is not queued (uplink FIFO full or datagram too long):
+// magic, rejected datagram length (2 bytes) and free uplink FIFO space [bytes] (2 bytes), network byte order
+#define TELEMETRY_UPLINK_NAK_MAGIC  "NAK!"
+#define TELEMETRY_UPLINK_NAK_SIZE   8
+
+// UART baud rate control, datagram sent to CONFIG_PORT (it is not forwarded to AAT):
+// magic, UART link (1 byte: 0 - telemetry, 1 - AAT), baud rate (4 bytes, network byte order).
+// Baud rate 0 starts autobaud, BRIDGE_BAUD_QUERY only reports current state.
+// Reply: magic, UART link, status (bridgeBaudStatus_t), autobaud state (bridgeAutobaud_t), baud rate (4 bytes)
+#define BRIDGE_BAUD_MAGIC           "BAUD"
+#define BRIDGE_BAUD_REQUEST_SIZE    9
+#define BRIDGE_BAUD_REPLY_SIZE      11
+#define BRIDGE_BAUD_AUTO            0
+#define BRIDGE_BAUD_QUERY           0xFFFFFFFFu
+
+typedef enum {
+    BridgeBaud_Ok,
+    BridgeBaud_InvalidLink,     // No such link or its UART is not open
+    BridgeBaud_UnsupportedRate,
+} bridgeBaudStatus_t;
+
+typedef enum {
+    BridgeAutobaud_Off,         // Fixed rate
+    BridgeAutobaud_Searching,   // Candidate rates are tried
+    BridgeAutobaud_Locked,      // Rate is found
+} bridgeAutobaud_t;
+
+typedef struct {
+    uint32_t bindAddr;          // Local address of UDP sockets, network byte order
+    uint32_t downlinkAddr;      // Destination of telemetry downlink datagrams when nobody has subscribed, network byte order
+    uint32_t multicastAddr;     // Downlink multicast group for subscribers, network byte order. 0 - unicast to each subscriber
+    bool isDownlinkCompressed;  // Downlink datagrams are encoded by sport_codec.h
+} bridgeSettings_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    void bridge_Init(void);
+    void bridge_Start(const bridgeSettings_t *settings);
+    void bridge_Run(void);
+
+#ifdef __cplusplus
+}   // extern "C"
+#endif
+
+#endif // __BRIDGE_H__
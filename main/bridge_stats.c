@@ -0,0 +1,118 @@
+/**
+    @file
+    @brief   Bridge runtime counters and stats query protocol
+*/
+
+#include <string.h>
+#include <stdatomic.h>
+
+#include "bridge_stats.h"
+
+//------------ Definitions ----------//
+
+//------------ Variables ------------//
+
+static _Atomic uint32_t counters[BridgeStat_Count];
+
+//------------ Externals ------------//
+
+//------------ Prototypes -----------//
+
+//--------- Implementation ----------//
+
+
+static void putU32(uint8_t *dst, uint32_t value)
+{
+    dst[0] = value >> 24;
+    dst[1] = value >> 16;
+    dst[2] = value >> 8;
+    dst[3] = value;
+}
+
+
+/**
+    @brief  Add value to a counter
+    @param[in]  id Counter
+    @param[in]  value Value to add
+    @return None
+*/
+void bridgeStats_Add(bridgeStat_t id, uint32_t value)
+{
+    atomic_fetch_add_explicit(&counters[id], value, memory_order_relaxed);
+}
+
+
+/**
+    @brief  Set counter value, for counters mirrored from state owned by single task
+    @param[in]  id Counter
+    @param[in]  value New value
+    @return None
+*/
+void bridgeStats_Set(bridgeStat_t id, uint32_t value)
+{
+    atomic_store_explicit(&counters[id], value, memory_order_relaxed);
+}
+
+
+/**
+    @brief  Raise high-water mark counter
+    @param[in]  id Counter
+    @param[in]  value Current level, counter is updated if it is lower
+    @return None
+*/
+void bridgeStats_Max(bridgeStat_t id, uint32_t value)
+{
+    uint32_t current = atomic_load_explicit(&counters[id], memory_order_relaxed);
+    while ((value > current) &&
+           !atomic_compare_exchange_weak_explicit(&counters[id], &current, value,
+                                                  memory_order_relaxed, memory_order_relaxed))
+    {
+    }
+}
+
+
+/**
+    @brief  Get counter value
+    @param[in]  id Counter
+    @return Counter value
+*/
+uint32_t bridgeStats_Get(bridgeStat_t id)
+{
+    return atomic_load_explicit(&counters[id], memory_order_relaxed);
+}
+
+
+/**
+    @brief  Build response to stats query datagram
+    @param[in]  request Received datagram
+    @param[in]  requestLen Length of received datagram
+    @param[out] response Response buffer
+    @param[in]  responseSize Size of response buffer
+    @param[in]  uptimeMs Time since start [ms]
+    @return Response length, 0 if request is not valid and must be ignored
+*/
+uint32_t bridgeStats_HandleRequest(const uint8_t *request, uint32_t requestLen,
+                                   uint8_t *response, uint32_t responseSize, uint32_t uptimeMs)
+{
+    uint32_t count = BridgeStat_Count;
+    uint32_t i;
+
+    if ((requestLen < BRIDGE_STATS_MAGIC_SIZE) || (memcmp(request, BRIDGE_STATS_MAGIC, BRIDGE_STATS_MAGIC_SIZE) != 0))
+        return 0;
+    if (responseSize < BRIDGE_STATS_HEADER_SIZE)
+        return 0;
+    if (count > (responseSize - BRIDGE_STATS_HEADER_SIZE) / 4)
+        count = (responseSize - BRIDGE_STATS_HEADER_SIZE) / 4;
+
+    bridgeStats_Inc(BridgeStat_StatsRequests);
+
+    memcpy(response, BRIDGE_STATS_MAGIC, BRIDGE_STATS_MAGIC_SIZE);
+    response[4] = BRIDGE_STATS_VERSION;
+    response[5] = count;
+    response[6] = 0;
+    response[7] = 0;
+    putU32(&response[8], uptimeMs);
+    for (i = 0; i < count; i++)
+        putU32(&response[BRIDGE_STATS_HEADER_SIZE + i * 4], bridgeStats_Get((bridgeStat_t)i));
+    return BRIDGE_STATS_HEADER_SIZE + count * 4;
+}
@@ -0,0 +1,133 @@
+/**
+    @file
+    @brief   Bridge runtime counters and stats query protocol
+
+    Counters are updated lock-free from any task and read by the stats query
+    handler. Query: UDP datagram holding BRIDGE_STATS_MAGIC sent to STATS_PORT.
+    Response (all fields network byte order):
+
+        offset  size
+        0       4       BRIDGE_STATS_MAGIC
+        4       1       BRIDGE_STATS_VERSION
+        5       1       number of counters N
+        6       2       reserved, 0
+        8       4       uptime [ms]
+        12      4 * N   counters in bridgeStat_t order
+
+    New counters are appended to bridgeStat_t only, so existing indexes keep
+    their meaning.
+*/
+
+#ifndef __BRIDGE_STATS_H__
+#define __BRIDGE_STATS_H__
+
+#include <stdint.h>
+
+#define BRIDGE_STATS_MAGIC          "STAT"
+#define BRIDGE_STATS_MAGIC_SIZE     4
+#define BRIDGE_STATS_VERSION        1
+#define BRIDGE_STATS_HEADER_SIZE    12
+
+typedef enum {
+    // Telemetry UART (receiver / TX module SmartPort)
+    BridgeStat_TelemetryUartRxBytes,
+    BridgeStat_TelemetryUartOverflows,          // HW FIFO or driver RX buffer overflows
+    BridgeStat_TelemetryUartBreaks,
+    BridgeStat_TelemetryUartFrameErrors,        // Frame and parity errors
+    // SmartPort decoder
+    BridgeStat_SportFrames,
+    BridgeStat_SportPolls,
+    BridgeStat_SportCrcErrors,
+    BridgeStat_SportFramingErrors,
+    // Telemetry downlink: smartPortDownlinkFifo -> UDP
+    BridgeStat_DownlinkFramesQueued,
+    BridgeStat_DownlinkFramesDropped,           // Downlink FIFO full
+    BridgeStat_DownlinkFifoSize,                // [bytes]
+    BridgeStat_DownlinkFifoHighWater,           // [bytes]
+    BridgeStat_DownlinkDatagrams,
+    BridgeStat_DownlinkBytes,
+    BridgeStat_DownlinkSendErrors,
+    // Telemetry uplink: UDP -> telemetry server
+    BridgeStat_UplinkDatagrams,
+    BridgeStat_UplinkBytes,
+    // Telemetry UART -> AAT UART
+    BridgeStat_AatTelemetryBytes,
+    BridgeStat_AatTelemetrySkippedBytes,        // Not forwarded, AAT is in config mode
+    BridgeStat_AatTelemetryDroppedBytes,        // AAT UART TX buffer full
+    // Config channel: AAT UART <-> CONFIG_PORT
+    BridgeStat_ConfigDownlinkDatagrams,
+    BridgeStat_ConfigDownlinkBytes,
+    BridgeStat_ConfigDownlinkSendErrors,
+    BridgeStat_ConfigDownlinkDroppedBytes,      // Configurator address is not known yet
+    BridgeStat_ConfigUplinkDatagrams,
+    BridgeStat_ConfigUplinkBytes,
+    BridgeStat_ConfigUplinkDroppedBytes,        // AAT UART TX buffer full
+    BridgeStat_ConfigModeEntries,
+    BridgeStat_ConfigModeTime,                  // Completed config mode sessions [ms]
+    // Stats endpoint
+    BridgeStat_StatsRequests,
+    // Telemetry downlink subscribers
+    BridgeStat_Subscribers,
+    BridgeStat_SubscriberJoins,
+    BridgeStat_SubscriberExpiries,
+    BridgeStat_SubscribersRejected,             // Subscriber table full
+    // Telemetry uplink: smartPortUplinkFifo -> telemetry UART
+    BridgeStat_UplinkDatagramsQueued,
+    BridgeStat_UplinkDatagramsRejected,         // Uplink FIFO full or datagram too long, NAK is sent
+    BridgeStat_UplinkFifoHighWater,             // [bytes]
+    BridgeStat_UplinkUartDatagrams,
+    BridgeStat_UplinkUartBytes,
+    BridgeStat_UplinkUnpacedWrites,             // Written on silent line, without poll slot
+    BridgeStat_ConfigDownlinkFifoDroppedBytes,  // configDownlinkFifo full
+    BridgeStat_TelemetryTimeouts,               // No telemetry UART data for TELEMETRY_TIMEOUT
+    // AAT UART link
+    BridgeStat_AatUartRxBytes,
+    BridgeStat_AatUartOverflows,
+    BridgeStat_AatUartBreaks,
+    BridgeStat_AatUartFrameErrors,
+    // Buffer pool
+    BridgeStat_BufferPoolExhausted,             // Failed allocations, data is left in UART driver or dropped
+    BridgeStat_BufferPoolHighWater,             // Max blocks in use
+    // UART baud rate control
+    BridgeStat_TelemetryUartBaudRate,
+    BridgeStat_AatUartBaudRate,
+    BridgeStat_BaudRateChanges,                 // Requested and autobaud candidate changes
+    BridgeStat_AutobaudLocks,
+    // Boot phase times since app start [ms], 0 - not reached, see boot_timing.h
+    BridgeStat_BootNvsReadyMs,
+    BridgeStat_BootUartsReadyMs,
+    BridgeStat_BootWifiStartedMs,
+    BridgeStat_BootSocketBoundMs,
+    BridgeStat_BootFirstUartDataMs,
+    BridgeStat_BootFirstDatagramMs,
+    // Downlink FIFO overflow, counters of the active policy grow only
+    BridgeStat_DownlinkOverflowPolicy,          // 0 - drop newest (DownlinkFramesDropped), 1 - drop oldest, 2 - drop oldest frames
+    BridgeStat_DownlinkEvictedBytes,            // Drop oldest policies
+    BridgeStat_DownlinkEvictedFrames,           // Drop oldest frames policy
+    // Compressed downlink, DownlinkBytes counts encoded bytes
+    BridgeStat_DownlinkCodecRawBytes,           // Frame bytes encoded
+    BridgeStat_DownlinkCodecBytes,              // Encoded datagram bytes, once per datagram
+    BridgeStat_DownlinkCodecKeys,               // Key datagrams, dictionary is reset
+    BridgeStat_DownlinkCodecLiterals,           // Frames sent as received
+    BridgeStat_Count
+} bridgeStat_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    void bridgeStats_Add(bridgeStat_t id, uint32_t value);
+    void bridgeStats_Set(bridgeStat_t id, uint32_t value);
+    void bridgeStats_Max(bridgeStat_t id, uint32_t value);
+    uint32_t bridgeStats_Get(bridgeStat_t id);
+    uint32_t bridgeStats_HandleRequest(const uint8_t *request, uint32_t requestLen,
+                                       uint8_t *response, uint32_t responseSize, uint32_t uptimeMs);
+
+#ifdef __cplusplus
+}   // extern "C"
+#endif
+
+#define bridgeStats_Inc(id)         bridgeStats_Add(id, 1)
+
+#endif // __BRIDGE_STATS_H__
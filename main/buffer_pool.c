@@ -0,0 +1,173 @@
+/**
+    @file
+    @brief   Fixed-block pool of reference counted buffers
+*/
+
+#include "hal.h"
+#include "buffer_pool.h"
+
+//------------ Definitions ----------//
+
+#define FREE_LIST_END               0xFFFFu
+#define FREE_HEAD_INDEX_MASK        0xFFFFu
+#define FREE_HEAD_TAG_STEP          0x10000u    // Tag is bumped on every update, so a stale head never matches (ABA)
+
+//------------ Variables ------------//
+
+static const char *POOL_TAG = "Buffer pool";
+
+//------------ Externals ------------//
+
+//------------ Prototypes -----------//
+
+//--------- Implementation ----------//
+
+
+static inline bufferPool_Buffer_t *blockAt(const bufferPool_t *pool, uint32_t index)
+{
+    return (bufferPool_Buffer_t *)(pool->storage + index * pool->stride);
+}
+
+
+static inline uint32_t nextHead(uint32_t head, uint32_t index)
+{
+    return ((head + FREE_HEAD_TAG_STEP) & ~FREE_HEAD_INDEX_MASK) | index;
+}
+
+
+/**
+    @brief  Init pool, all blocks are free
+    @param[out] pool Pool
+    @param[in]  storage Block storage of BUFFER_POOL_STORAGE_SIZE(blockSize, blockCount) bytes, 8-byte aligned
+    @param[in]  blockSize Data size of one block [bytes]
+    @param[in]  blockCount Number of blocks, up to BUFFER_POOL_MAX_BLOCKS
+    @param[in]  statExhausted Counter of failed allocations
+    @param[in]  statHighWater Counter of max blocks in use
+    @return None
+*/
+void bufferPool_Init(bufferPool_t *pool, uint8_t *storage, uint32_t blockSize, uint32_t blockCount,
+                     bridgeStat_t statExhausted, bridgeStat_t statHighWater)
+{
+    uint32_t i;
+
+    if (blockCount > BUFFER_POOL_MAX_BLOCKS)
+    {
+        HAL_LOGE(POOL_TAG, "Too many blocks: %u", (unsigned)blockCount);
+        blockCount = BUFFER_POOL_MAX_BLOCKS;
+    }
+    pool->storage = storage;
+    pool->stride = BUFFER_POOL_STRIDE(blockSize);
+    pool->blockSize = blockSize;
+    pool->blockCount = blockCount;
+    pool->statExhausted = statExhausted;
+    pool->statHighWater = statHighWater;
+    for (i = 0; i < blockCount; i++)
+    {
+        bufferPool_Buffer_t *buf = blockAt(pool, i);
+        buf->pool = pool;
+        buf->index = i;
+        buf->len = 0;
+        atomic_init(&buf->refCount, 0);
+        atomic_init(&buf->next, (i + 1 < blockCount) ? i + 1 : FREE_LIST_END);
+    }
+    atomic_init(&pool->freeHead, (blockCount > 0) ? 0 : FREE_LIST_END);
+    atomic_init(&pool->inUse, 0);
+    atomic_init(&pool->waiters, 0);
+    pool->releaseSignal = hal_SignalCreate();
+}
+
+
+/**
+    @brief  Take a free block
+    @param[in]  pool Pool
+    @return Buffer with one reference and len 0, NULL if pool is exhausted
+*/
+bufferPool_Buffer_t *bufferPool_Alloc(bufferPool_t *pool)
+{
+    uint32_t head = atomic_load(&pool->freeHead);
+    bufferPool_Buffer_t *buf;
+
+    do
+    {
+        uint32_t index = head & FREE_HEAD_INDEX_MASK;
+        if (index == FREE_LIST_END)
+        {
+            bridgeStats_Inc(pool->statExhausted);
+            return NULL;
+        }
+        buf = blockAt(pool, index);
+    } while (!atomic_compare_exchange_weak(&pool->freeHead, &head,
+                                           nextHead(head, atomic_load_explicit(&buf->next, memory_order_relaxed))));
+
+    atomic_store_explicit(&buf->refCount, 1, memory_order_relaxed);
+    buf->len = 0;
+    bridgeStats_Max(pool->statHighWater, atomic_fetch_add_explicit(&pool->inUse, 1, memory_order_relaxed) + 1);
+    return buf;
+}
+
+
+/**
+    @brief  Take another reference to buffer
+    @param[in]  buf Buffer, caller must hold a reference already
+    @return None
+*/
+void bufferPool_Ref(bufferPool_Buffer_t *buf)
+{
+    atomic_fetch_add_explicit(&buf->refCount, 1, memory_order_relaxed);
+}
+
+
+/**
+    @brief  Drop reference, block is returned to the pool with the last one
+    @param[in]  buf Buffer
+    @return None
+*/
+void bufferPool_Release(bufferPool_Buffer_t *buf)
+{
+    // Acquire-release: writes of all holders are done before the block is reused
+    if (atomic_fetch_sub_explicit(&buf->refCount, 1, memory_order_acq_rel) != 1)
+        return;
+
+    bufferPool_t *pool = buf->pool;
+    uint32_t head = atomic_load(&pool->freeHead);
+    do
+    {
+        atomic_store_explicit(&buf->next, head & FREE_HEAD_INDEX_MASK, memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak(&pool->freeHead, &head, nextHead(head, buf->index)));
+    atomic_fetch_sub_explicit(&pool->inUse, 1, memory_order_relaxed);
+
+    // Seq-cst pairs with bufferPool_WaitFree(): either the waiter sees the block or we see the waiter
+    if (atomic_load(&pool->waiters) > 0)
+        hal_SignalGive(pool->releaseSignal);
+}
+
+
+/**
+    @brief  Get number of free blocks
+    @param[in]  pool Pool
+    @return Number of free blocks, may be outdated at once
+*/
+uint32_t bufferPool_FreeCount(bufferPool_t *pool)
+{
+    return pool->blockCount - atomic_load_explicit(&pool->inUse, memory_order_relaxed);
+}
+
+
+/**
+    @brief  Wait until pool has a free block
+            The block is not reserved, another task may take it before the caller's bufferPool_Alloc().
+    @param[in]  pool Pool
+    @param[in]  timeoutMs Max wait time [ms]
+    @return True if a block is free, false on timeout
+*/
+bool bufferPool_WaitFree(bufferPool_t *pool, uint32_t timeoutMs)
+{
+    bool isFree;
+
+    atomic_fetch_add(&pool->waiters, 1);
+    isFree = (atomic_load(&pool->freeHead) & FREE_HEAD_INDEX_MASK) != FREE_LIST_END;
+    if (!isFree)
+        isFree = hal_SignalWait(pool->releaseSignal, timeoutMs);
+    atomic_fetch_sub(&pool->waiters, 1);
+    return isFree;
+}
@@ -0,0 +1,77 @@
+/**
+    @file
+    @brief   Fixed-block pool of reference counted buffers
+
+    Blocks are carved from storage provided by the caller at init time, so
+    the pool never touches the heap. Alloc and release are O(1) lock-free
+    operations on a free list, safe from any task.
+
+    A buffer is allocated with one reference. Code that keeps the buffer
+    after passing it on (e.g. a sink that queues it) takes another reference
+    with bufferPool_Ref(), and every holder calls bufferPool_Release() when
+    done. The block returns to the pool with the last release, so the same
+    data can be shared by any number of consumers without copying.
+
+    A task that finds the pool exhausted can sleep in bufferPool_WaitFree()
+    until a block is released instead of polling. Each release wakes one
+    waiter, so the wait is bounded by the caller and a false return means
+    the sinks still hold every block.
+*/
+
+#ifndef __BUFFER_POOL_H__
+#define __BUFFER_POOL_H__
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "hal.h"
+#include "bridge_stats.h"
+
+#define BUFFER_POOL_MAX_BLOCKS      0xFFFF
+
+typedef struct bufferPool_s bufferPool_t;
+
+typedef struct {
+    bufferPool_t *pool;
+    atomic_uint refCount;
+    _Atomic uint16_t next;          // Free list link, used while block is free
+    uint16_t index;
+    uint32_t len;                   // Number of valid bytes in data, set by owner
+    uint8_t data[];                 // bufferPool_t.blockSize bytes
+} bufferPool_Buffer_t;
+
+struct bufferPool_s {
+    uint8_t *storage;
+    uint32_t stride;                // Header and data of one block [bytes]
+    uint32_t blockSize;             // Data size of one block [bytes]
+    uint32_t blockCount;
+    atomic_uint freeHead;           // Update tag << 16 | first free block index
+    atomic_uint inUse;
+    atomic_uint waiters;            // Tasks in bufferPool_WaitFree()
+    hal_Signal_t releaseSignal;     // Given by release while there are waiters
+    bridgeStat_t statExhausted;     // Failed allocations
+    bridgeStat_t statHighWater;     // Max blocks in use
+};
+
+// Storage size for blockCount blocks holding blockSize bytes each, storage must be 8-byte aligned
+#define BUFFER_POOL_STRIDE(blockSize)                   ((sizeof(bufferPool_Buffer_t) + (blockSize) + 7) & ~7u)
+#define BUFFER_POOL_STORAGE_SIZE(blockSize, blockCount) (BUFFER_POOL_STRIDE(blockSize) * (blockCount))
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    void bufferPool_Init(bufferPool_t *pool, uint8_t *storage, uint32_t blockSize, uint32_t blockCount,
+                         bridgeStat_t statExhausted, bridgeStat_t statHighWater);
+    bufferPool_Buffer_t *bufferPool_Alloc(bufferPool_t *pool);
+    void bufferPool_Ref(bufferPool_Buffer_t *buf);
+    void bufferPool_Release(bufferPool_Buffer_t *buf);
+    uint32_t bufferPool_FreeCount(bufferPool_t *pool);
+    bool bufferPool_WaitFree(bufferPool_t *pool, uint32_t timeoutMs);
+
+#ifdef __cplusplus
+}   // extern "C"
+#endif
+
+#endif // __BUFFER_POOL_H__
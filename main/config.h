@@ -1,8 +1,10 @@
 #ifndef __CONFIG_H__
 #define __CONFIG_H__
 
+#ifdef ESP_PLATFORM
 #include "driver/gpio.h"
 #include "driver/uart.h"
+#endif
 
 
 #define ESP_WIFI_SSID      "esp32_wifi"
@@ -17,20 +19,72 @@
 
 #define TELEMETRY_PORT              3151
 #define CONFIG_PORT                 3140
+#define STATS_PORT                  3152        // Runtime counters query, see bridge_stats.h
 
+#define TELEMETRY_DOWNLINK_FIFO_SIZE    2048    // Whole SmartPort frames, UART -> UDP [bytes]
+#define TELEMETRY_DOWNLINK_OVERFLOW_POLICY  OverflowPolicy_DropOldestFrames     // FIFO full: OverflowPolicy_DropNewest keeps
+                                                                                // stale data, OverflowPolicy_DropOldest[Frames]
+                                                                                // keeps the freshest telemetry
+#define TELEMETRY_DOWNLINK_COMPRESSION  0       // Compress downlink datagrams (sport_codec.h), ground stations decode them with sport_decode.
+                                                // Datagrams are coalesced as without it (TELEMETRY_MAX_HOLD_TIME), so latency is the same,
+                                                // but IP/UDP headers dominate small datagrams: WiFi bytes shrink ~1.6x at 4-5 frames
+                                                // per datagram, ~2x needs ~16 frames, i.e. a longer hold time
+#define TELEMETRY_CODEC_KEY_INTERVAL    1000    // Compressed downlink: max time between key datagrams, bounds recovery after loss [ms]
+#define TELEMETRY_CODEC_MIN_KEY_INTERVAL 250    // Compressed downlink: min time between keys forced by new subscribers or sensors [ms]
+#define TELEMETRY_CODEC_DATAGRAM_SIZE   512     // Compressed downlink: max frame bytes per datagram, a key one carries the dictionary too [bytes]
+#define TELEMETRY_DATAGRAM_SIZE         1024    // Target (and max) downlink datagram payload [bytes], must fit into MTU (1472)
+#define TELEMETRY_MAX_HOLD_TIME         4       // Max time downlink data is held for coalescing, below the former 5 ms
+                                                // send cadence so tail latency does not grow on a busy line [ms]
+#define TELEMETRY_SERVER_IDLE_TIMEOUT   1000    // Max sleep time of telemetry server when no events occur [ms]
+#define TELEMETRY_MAX_SUBSCRIBERS       MAX_STA_CONN
+#define TELEMETRY_SUBSCRIBER_TIMEOUT    5000    // Subscriber is removed if no hello is received for this time [ms]
+#define TELEMETRY_MULTICAST_GROUP       {239, 255, 12, 51}
+#define ENA_TELEMETRY_MULTICAST         0       // Send downlink to TELEMETRY_MULTICAST_GROUP instead of unicast to each subscriber
+#define TELEMETRY_UPLINK_FIFO_SIZE      1024    // [bytes]
+#define TELEMETRY_UPLINK_MAX_DATAGRAM   32      // Max uplink datagram payload, written to UART within one slot [bytes]
+#define TELEMETRY_UPLINK_PHYS_ID        0x0D    // Uplink datagram is written when this SmartPort physical ID is polled and not answered
+#define TELEMETRY_UPLINK_SLOT_WINDOW    2       // Max delay between poll and uplink write [ms]
+#define TELEMETRY_UPLINK_SILENT_TIME    50      // No UART RX for this time: no bus master, uplink is written without pacing [ms]
+
+#ifdef ESP_PLATFORM
 #define TELEMETRY_UART              UART_NUM_2
+#else
+#define TELEMETRY_UART              0           // Host build: serial device is selected by daemon command line
+#endif
+#define TELEMETRY_BAUD_RATE         115200
+#define TELEMETRY_AUTOBAUD          0       // Start in autobaud mode: rate is locked when SmartPort frames validate
 #define TELEMETRY_RX_PIN            16
 #define TELEMETRY_TX_PIN            17
+#define TELEMETRY_RX_TIMEOUT        3       // Line idle time after which received data is reported and held
+                                            // downlink data is flushed [UART symbols, up to 126]
 
+#ifdef ESP_PLATFORM
 #define AAT_UART                    UART_NUM_1
+#else
+#define AAT_UART                    1           // Host build: serial device is selected by daemon command line
+#endif
+#define AAT_BAUD_RATE               115200
+#define AAT_AUTOBAUD                0       // Start in autobaud mode: rate is locked when data arrives without frame errors
 #define AAT_RX_PIN                  18
 #define AAT_TX_PIN                  19
+#define AAT_RX_TIMEOUT              10          // [UART symbols]
+
+#define UART_AUTOBAUD_RATES         9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600  // Candidates, tried in this order
+#define UART_AUTOBAUD_DWELL_TIME    300         // Time data is checked at each candidate rate [ms]
 
+#ifdef ESP_PLATFORM
 #define TELEM_LED_PIN               GPIO_NUM_2      // Blinks when telemetry data (any) is coming from telemetry UART
 #define AAT_TELEM_MODE_LED_PIN      GPIO_NUM_27     // Active when AAT UART is in telemetry mode (receives telemetry)
 #define AAT_CONFIG_MODE_LED_PIN     GPIO_NUM_25     // Active when AAT UART is in configurator mode (data exchange with UDP CONFIG_PORT)
+#endif
 
 #define AAT_CONFIG_TIMEOUT          2000    // When configuration becomes active, telemetry stream is disabled for this time [ms]
+#define CONFIG_DOWNLINK_QUEUE_SIZE  8       // AAT -> configurator, each AAT UART read is queued as one pool buffer [buffers]
+
+#define BUFFER_POOL_BLOCK_SIZE      256     // UART read chunk and max received UDP datagram [bytes]
+#define BUFFER_POOL_BLOCK_COUNT     16      // UART readers and UDP servers hold one block each while forwarding,
+                                            // plus up to CONFIG_DOWNLINK_QUEUE_SIZE queued blocks
+#define BUFFER_POOL_WAIT_TIME       20      // UART reader waits this long for a released block when pool is exhausted [ms]
 
 
 
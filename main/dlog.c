@@ -0,0 +1,140 @@
+/**
+    @file
+    @brief   Deferred binary logging
+*/
+
+#include <stdatomic.h>
+
+#include "hal.h"
+#include "dlog.h"
+#include "xfifo.h"
+
+//------------ Definitions ----------//
+
+#define DLOG_TASK_PRIORITY      1
+#define DLOG_TEXT_SIZE          128
+
+//------------ Variables ------------//
+
+static const char *DLOG_TAG = "dlog";
+
+static xFifo_t dlogRing;                                // Written by any task with xFifo_PutMP()
+static dlogRecord_t dlogRingStorage[DLOG_RING_SIZE];
+static atomic_uint dlogLostRecords;
+static hal_Signal_t dlogSignal;                         // Given when records are waiting for formatter
+static atomic_bool isWakeRequested;                     // dlogSignal is given, formatter has not started draining yet
+static bool isInitialized;
+
+//------------ Externals ------------//
+
+//------------ Prototypes -----------//
+
+static void dlog_task(void *pvParameters);
+
+//--------- Implementation ----------//
+
+
+/**
+    @brief  Init log ring, records written before this call are dropped
+    @return None
+*/
+void dlog_Init(void)
+{
+    xFifo_CreateStatic(&dlogRing, sizeof(dlogRecord_t), (uint8_t *)dlogRingStorage, DLOG_RING_SIZE);
+    dlogSignal = hal_SignalCreate();
+    isInitialized = true;
+}
+
+
+/**
+    @brief  Start formatter task
+    @return None
+*/
+void dlog_Start(void)
+{
+    hal_TaskCreate(dlog_task, "dlog", 3072, 0, DLOG_TASK_PRIORITY);
+}
+
+
+/**
+    @brief  Put record into log ring. Use DLOGx() macros instead of calling it directly
+    @param[in]  level Record level, DLOG_LEVEL_x
+    @param[in]  tag Record source, string literal
+    @param[in]  format printf-like format, string literal
+    @param[in]  argCount Number of valid arguments
+    @param[in]  a0..a5 Arguments
+    @return None
+*/
+void dlog_Write(uint8_t level, const char *tag, const char *format, uint32_t argCount,
+                uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3, uint32_t a4, uint32_t a5)
+{
+    dlogRecord_t record = {
+        .format = format,
+        .tag = tag,
+        .timestamp = (uint32_t)(hal_GetTimeUs() / 1000),
+        .level = level,
+        .argCount = argCount,
+        .args = {a0, a1, a2, a3, a4, a5},
+    };
+    if (!isInitialized || (xFifo_PutMP(&dlogRing, &record, 1) == 0))
+    {
+        atomic_fetch_add_explicit(&dlogLostRecords, 1, memory_order_relaxed);
+        return;
+    }
+    // Only the first record after formatter has drained the ring wakes it
+    if (!atomic_exchange(&isWakeRequested, true))
+        hal_SignalGive(dlogSignal);
+}
+
+
+/**
+    @brief  Format record and pass it to platform log
+    @param[in]  record Record
+    @return None
+*/
+static void dlog_Emit(const dlogRecord_t *record)
+{
+    char text[DLOG_TEXT_SIZE];
+    const uint32_t *a = record->args;
+
+    // Unused trailing arguments are zero and ignored by the format
+    snprintf(text, sizeof(text), record->format, a[0], a[1], a[2], a[3], a[4], a[5]);
+    switch (record->level)
+    {
+        case DLOG_LEVEL_ERROR:
+            HAL_LOGE(record->tag, "[%u] %s", record->timestamp, text);
+            break;
+        case DLOG_LEVEL_WARNING:
+            HAL_LOGW(record->tag, "[%u] %s", record->timestamp, text);
+            break;
+        case DLOG_LEVEL_INFO:
+            HAL_LOGI(record->tag, "[%u] %s", record->timestamp, text);
+            break;
+        default:
+            HAL_LOGD(record->tag, "[%u] %s", record->timestamp, text);
+            break;
+    }
+}
+
+
+static void dlog_task(void *pvParameters)
+{
+    dlogRecord_t record;
+    uint32_t reportedLost = 0;
+
+    while (1)
+    {
+        hal_SignalWait(dlogSignal, DLOG_IDLE_TIMEOUT);
+        // Cleared before draining: a record put after this point gives the signal again
+        atomic_store(&isWakeRequested, false);
+        while (xFifo_Get(&dlogRing, &record, 1) > 0)
+            dlog_Emit(&record);
+
+        uint32_t lost = atomic_load_explicit(&dlogLostRecords, memory_order_relaxed);
+        if (lost != reportedLost)
+        {
+            HAL_LOGW(DLOG_TAG, "%u records lost", lost - reportedLost);
+            reportedLost = lost;
+        }
+    }
+}
@@ -0,0 +1,103 @@
+/**
+    @file
+    @brief   Deferred binary logging
+
+    Hot paths write fixed-size records (format, tag, timestamp and up to
+    DLOG_MAX_ARGS integer arguments) into a ring. dlog_task formats and
+    emits them through HAL_LOGx at low priority, so the caller pays for a
+    record copy instead of formatting and console output. The formatter
+    sleeps until a record arrives.
+
+    Rules for DLOGx() calls:
+    - format and tag must point to static strings (only pointers are stored)
+    - arguments must be integers of up to 32 bits, %s is not supported
+    Formats are checked by the compiler as for printf().
+
+    Levels above DLOG_LEVEL are removed at compile time, arguments of removed
+    calls are not evaluated. If the ring is full, records are dropped and
+    counted; the formatter reports the number of lost records.
+*/
+
+#ifndef __DLOG_H__
+#define __DLOG_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define DLOG_LEVEL_NONE         0
+#define DLOG_LEVEL_ERROR        1
+#define DLOG_LEVEL_WARNING      2
+#define DLOG_LEVEL_INFO         3
+#define DLOG_LEVEL_DEBUG        4
+
+#ifndef DLOG_LEVEL
+#define DLOG_LEVEL              DLOG_LEVEL_INFO
+#endif
+
+#define DLOG_MAX_ARGS           6
+#define DLOG_RING_SIZE          64      // [records]
+#define DLOG_IDLE_TIMEOUT       1000    // Max sleep of formatter, it is woken by the first record put into empty ring [ms]
+
+typedef struct {
+    const char *format;
+    const char *tag;
+    uint32_t timestamp;         // [ms]
+    uint8_t level;              // DLOG_LEVEL_x
+    uint8_t argCount;
+    uint32_t args[DLOG_MAX_ARGS];
+} dlogRecord_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    void dlog_Init(void);
+    void dlog_Start(void);
+    void dlog_Write(uint8_t level, const char *tag, const char *format, uint32_t argCount,
+                    uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3, uint32_t a4, uint32_t a5);
+
+#ifdef __cplusplus
+}   // extern "C"
+#endif
+
+// Argument count and zero padding for up to DLOG_MAX_ARGS arguments
+#define DLOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, n, ...)     n
+#define DLOG_NARGS(...)                 DLOG_NARGS_(0, ##__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0)
+#define DLOG_ARGS_(_0, a0, a1, a2, a3, a4, a5, ...)         \
+    (uint32_t)(a0), (uint32_t)(a1), (uint32_t)(a2), (uint32_t)(a3), (uint32_t)(a4), (uint32_t)(a5)
+#define DLOG_ARGS(...)                  DLOG_ARGS_(0, ##__VA_ARGS__, 0, 0, 0, 0, 0, 0)
+
+#define DLOG_WRITE_M(level, tag, format, ...)                                               \
+    do {                                                                                    \
+        _Static_assert(DLOG_NARGS(__VA_ARGS__) <= DLOG_MAX_ARGS, "too many DLOG arguments"); \
+        if (0)                                                                              \
+            printf(format, ##__VA_ARGS__);      /* Format check only */                     \
+        dlog_Write(level, tag, format, DLOG_NARGS(__VA_ARGS__), DLOG_ARGS(__VA_ARGS__));    \
+    } while (0)
+
+#if DLOG_LEVEL >= DLOG_LEVEL_ERROR
+#define DLOGE(tag, format, ...)         DLOG_WRITE_M(DLOG_LEVEL_ERROR, tag, format, ##__VA_ARGS__)
+#else
+#define DLOGE(tag, format, ...)         do {} while (0)
+#endif
+
+#if DLOG_LEVEL >= DLOG_LEVEL_WARNING
+#define DLOGW(tag, format, ...)         DLOG_WRITE_M(DLOG_LEVEL_WARNING, tag, format, ##__VA_ARGS__)
+#else
+#define DLOGW(tag, format, ...)         do {} while (0)
+#endif
+
+#if DLOG_LEVEL >= DLOG_LEVEL_INFO
+#define DLOGI(tag, format, ...)         DLOG_WRITE_M(DLOG_LEVEL_INFO, tag, format, ##__VA_ARGS__)
+#else
+#define DLOGI(tag, format, ...)         do {} while (0)
+#endif
+
+#if DLOG_LEVEL >= DLOG_LEVEL_DEBUG
+#define DLOGD(tag, format, ...)         DLOG_WRITE_M(DLOG_LEVEL_DEBUG, tag, format, ##__VA_ARGS__)
+#else
+#define DLOGD(tag, format, ...)         do {} while (0)
+#endif
+
+#endif // __DLOG_H__
@@ -0,0 +1,114 @@
+/**
+    @file
+    @brief   Platform abstraction layer
+
+    Thin layer over UART, tasks, timing and logging used by the bridge logic.
+    Sockets are used through the BSD API, which is provided by lwIP on ESP32.
+    LEDs are accessed through drv_led.h.
+
+    Implementations:
+        hal_esp32.c         ESP-IDF (FreeRTOS, UART driver, lwIP)
+        host/hal_linux.c    Linux daemon (pthreads, termios, epoll)
+*/
+
+#ifndef __HAL_H__
+#define __HAL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef ESP_PLATFORM
+
+#include "esp_log.h"
+#include "lwip/sockets.h"
+
+#define HAL_LOGE(tag, format, ...)      ESP_LOGE(tag, format, ##__VA_ARGS__)
+#define HAL_LOGW(tag, format, ...)      ESP_LOGW(tag, format, ##__VA_ARGS__)
+#define HAL_LOGI(tag, format, ...)      ESP_LOGI(tag, format, ##__VA_ARGS__)
+#define HAL_LOGD(tag, format, ...)      ESP_LOGD(tag, format, ##__VA_ARGS__)
+
+#else
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define inet_ntoa_r(addr, buf, buflen)  inet_ntop(AF_INET, &(addr), buf, buflen)
+
+typedef enum {
+    HalLog_Error,
+    HalLog_Warning,
+    HalLog_Info,
+    HalLog_Debug,
+} hal_LogLevel_t;
+
+#define HAL_LOGE(tag, format, ...)      hal_Log(HalLog_Error, tag, format, ##__VA_ARGS__)
+#define HAL_LOGW(tag, format, ...)      hal_Log(HalLog_Warning, tag, format, ##__VA_ARGS__)
+#define HAL_LOGI(tag, format, ...)      hal_Log(HalLog_Info, tag, format, ##__VA_ARGS__)
+#define HAL_LOGD(tag, format, ...)      hal_Log(HalLog_Debug, tag, format, ##__VA_ARGS__)
+
+#endif
+
+#define HAL_WAIT_FOREVER        0xFFFFFFFFu
+
+typedef void (*hal_TaskFunction_t)(void *arg);
+typedef struct hal_Signal_s *hal_Signal_t;     // Binary signal used to wake a task, see hal_SignalCreate()
+typedef struct hal_Mutex_s *hal_Mutex_t;
+
+typedef struct {
+    int port;                   // UART number, see config.h
+    uint32_t baudRate;
+    int txPin;                  // Ignored by host implementation
+    int rxPin;                  // Ignored by host implementation
+    uint8_t rxTimeout;          // Line idle time after which data is reported [UART symbols]
+} hal_UartConfig_t;
+
+typedef enum {
+    HalUartEvent_Data,          // Data is avaliable for reading
+    HalUartEvent_Overflow,      // Received data was lost
+    HalUartEvent_Break,
+    HalUartEvent_FrameError,    // Frame or parity error
+} hal_UartEventType_t;
+
+typedef struct {
+    hal_UartEventType_t type;
+    bool lineIdle;              // Data event was reported because RX line became idle
+} hal_UartEvent_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    int64_t hal_GetTimeUs(void);
+    void hal_DelayMs(uint32_t ms);
+    bool hal_TaskCreate(hal_TaskFunction_t function, const char *name, uint32_t stackSize, void *arg, uint32_t priority);
+    hal_Signal_t hal_SignalCreate(void);
+    void hal_SignalGive(hal_Signal_t signal);
+    bool hal_SignalWait(hal_Signal_t signal, uint32_t timeoutMs);
+    hal_Mutex_t hal_MutexCreate(void);
+    void hal_MutexLock(hal_Mutex_t mutex);
+    void hal_MutexUnlock(hal_Mutex_t mutex);
+
+    bool hal_UartOpen(const hal_UartConfig_t *config);
+    bool hal_UartWaitEvent(int port, hal_UartEvent_t *event, uint32_t timeoutMs);
+    int hal_UartAvailable(int port);
+    int hal_UartRead(int port, void *data, uint32_t len);
+    int hal_UartWrite(int port, const void *data, uint32_t len);
+    void hal_UartFlushInput(int port);
+    bool hal_UartSetBaudRate(int port, uint32_t baudRate);
+    uint32_t hal_UartGetBaudRate(int port);
+
+#ifndef ESP_PLATFORM
+    void hal_Log(hal_LogLevel_t level, const char *tag, const char *format, ...) __attribute__((format(printf, 3, 4)));
+#endif
+
+#ifdef __cplusplus
+}   // extern "C"
+#endif
+
+#endif // __HAL_H__
@@ -0,0 +1,283 @@
+/**
+    @file
+    @brief   Platform abstraction layer, ESP-IDF implementation
+*/
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "driver/uart.h"
+#include "esp_timer.h"
+
+#include "hal.h"
+
+//------------ Definitions ----------//
+
+#define UART_BUFFER_SIZE            (1024 * 2)
+#define UART_EVENT_QUEUE_SIZE       10
+
+//------------ Variables ------------//
+
+static QueueHandle_t uartQueues[UART_NUM_MAX];
+
+//------------ Externals ------------//
+
+//------------ Prototypes -----------//
+
+//--------- Implementation ----------//
+
+
+/**
+    @brief  Get monotonic time
+    @return Time since boot [us]
+*/
+int64_t hal_GetTimeUs(void)
+{
+    return esp_timer_get_time();
+}
+
+
+/**
+    @brief  Block calling task
+    @param[in]  ms Delay [ms]
+    @return None
+*/
+void hal_DelayMs(uint32_t ms)
+{
+    vTaskDelay(ms / portTICK_PERIOD_MS);
+}
+
+
+/**
+    @brief  Create task
+    @param[in]  function Task function
+    @param[in]  name Task name
+    @param[in]  stackSize Stack size [bytes]
+    @param[in]  arg Argument passed to the task function
+    @param[in]  priority FreeRTOS task priority
+    @return True if task is created
+*/
+bool hal_TaskCreate(hal_TaskFunction_t function, const char *name, uint32_t stackSize, void *arg, uint32_t priority)
+{
+    return (xTaskCreate(function, name, stackSize, arg, priority, NULL) == pdPASS);
+}
+
+
+/**
+    @brief  Create binary signal
+            Signal is set by hal_SignalGive() and cleared by hal_SignalWait() that
+            returns it. Several gives before a wait are seen as one.
+    @return Signal, NULL on error
+*/
+hal_Signal_t hal_SignalCreate(void)
+{
+    return (hal_Signal_t)xSemaphoreCreateBinary();
+}
+
+
+/**
+    @brief  Set signal and wake task waiting for it
+    @param[in]  signal Signal
+    @return None
+*/
+void hal_SignalGive(hal_Signal_t signal)
+{
+    xSemaphoreGive((SemaphoreHandle_t)signal);
+}
+
+
+/**
+    @brief  Wait until signal is set and clear it
+    @param[in]  signal Signal
+    @param[in]  timeoutMs Timeout [ms] or HAL_WAIT_FOREVER
+    @return True if signal was set, false on timeout
+*/
+bool hal_SignalWait(hal_Signal_t signal, uint32_t timeoutMs)
+{
+    // Rounded up, so a deadline is never missed by sleeping too short
+    TickType_t ticks = (timeoutMs == HAL_WAIT_FOREVER) ? portMAX_DELAY :
+                       (timeoutMs + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;
+    return (xSemaphoreTake((SemaphoreHandle_t)signal, ticks) == pdTRUE);
+}
+
+
+/**
+    @brief  Create mutex
+    @return Mutex, NULL on error
+*/
+hal_Mutex_t hal_MutexCreate(void)
+{
+    return (hal_Mutex_t)xSemaphoreCreateMutex();
+}
+
+
+/**
+    @brief  Lock mutex, block until it is available
+    @param[in]  mutex Mutex
+    @return None
+*/
+void hal_MutexLock(hal_Mutex_t mutex)
+{
+    xSemaphoreTake((SemaphoreHandle_t)mutex, portMAX_DELAY);
+}
+
+
+/**
+    @brief  Unlock mutex
+    @param[in]  mutex Mutex
+    @return None
+*/
+void hal_MutexUnlock(hal_Mutex_t mutex)
+{
+    xSemaphoreGive((SemaphoreHandle_t)mutex);
+}
+
+
+/**
+    @brief  Configure UART and install driver with event queue
+    @param[in]  config UART configuration
+    @return True if UART is ready
+*/
+bool hal_UartOpen(const hal_UartConfig_t *config)
+{
+    const uart_port_t uart_num = config->port;
+    uart_config_t uart_config = {
+        .baud_rate = config->baudRate,
+        .data_bits = UART_DATA_8_BITS,
+        .parity = UART_PARITY_DISABLE,
+        .stop_bits = UART_STOP_BITS_1,
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+        .rx_flow_ctrl_thresh = 122,
+    };
+    if ((uart_num < 0) || (uart_num >= UART_NUM_MAX))
+        return false;
+    // Configure UART parameters
+    if (uart_param_config(uart_num, &uart_config) != ESP_OK)
+        return false;
+    if (uart_set_pin(uart_num, config->txPin, config->rxPin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE) != ESP_OK)
+        return false;
+    // Install UART driver using an event queue
+    if (uart_driver_install(uart_num, UART_BUFFER_SIZE, UART_BUFFER_SIZE, UART_EVENT_QUEUE_SIZE, &uartQueues[uart_num], 0) != ESP_OK)
+        return false;
+    // Report data as soon as the line becomes idle
+    return (uart_set_rx_timeout(uart_num, config->rxTimeout) == ESP_OK);
+}
+
+
+/**
+    @brief  Wait for UART driver event
+    @param[in]  port UART number
+    @param[out]  event Received event
+    @param[in]  timeoutMs Timeout [ms] or HAL_WAIT_FOREVER
+    @return True if event is received, false on timeout
+*/
+bool hal_UartWaitEvent(int port, hal_UartEvent_t *event, uint32_t timeoutMs)
+{
+    uart_event_t uartEvent;
+    TickType_t ticks = (timeoutMs == HAL_WAIT_FOREVER) ? portMAX_DELAY : timeoutMs / portTICK_PERIOD_MS;
+    if (xQueueReceive(uartQueues[port], &uartEvent, ticks) != pdTRUE)
+        return false;
+
+    event->lineIdle = false;
+    switch (uartEvent.type)
+    {
+        case UART_DATA:
+            event->type = HalUartEvent_Data;
+            event->lineIdle = uartEvent.timeout_flag;
+            break;
+        case UART_FIFO_OVF:
+        case UART_BUFFER_FULL:
+            event->type = HalUartEvent_Overflow;
+            break;
+        case UART_BREAK:
+            event->type = HalUartEvent_Break;
+            break;
+        case UART_FRAME_ERR:
+        case UART_PARITY_ERR:
+            event->type = HalUartEvent_FrameError;
+            break;
+        default:
+            // Other events are not used, report them as possible data
+            event->type = HalUartEvent_Data;
+            break;
+    }
+    return true;
+}
+
+
+/**
+    @brief  Get number of received bytes avaliable for reading
+    @param[in]  port UART number
+    @return Number of bytes
+*/
+int hal_UartAvailable(int port)
+{
+    size_t availCnt = 0;
+    uart_get_buffered_data_len(port, &availCnt);
+    return (int)availCnt;
+}
+
+
+/**
+    @brief  Read received data without blocking
+    @param[in]  port UART number
+    @param[out]  data Buffer for data
+    @param[in]  len Max number of bytes to read
+    @return Number of bytes read, negative on error
+*/
+int hal_UartRead(int port, void *data, uint32_t len)
+{
+    return uart_read_bytes(port, data, len, 0);
+}
+
+
+/**
+    @brief  Put data into UART transmit buffer
+    @param[in]  port UART number
+    @param[in]  data Data to send
+    @param[in]  len Number of bytes
+    @return Number of bytes written, negative on error
+*/
+int hal_UartWrite(int port, const void *data, uint32_t len)
+{
+    return uart_write_bytes(port, (const char *)data, len);
+}
+
+
+/**
+    @brief  Discard all received data
+    @param[in]  port UART number
+    @return None
+*/
+void hal_UartFlushInput(int port)
+{
+    uart_flush_input(port);
+}
+
+
+/**
+    @brief  Change baud rate of open UART, may be called while other tasks use the UART
+            RX timeout is set in symbols, so line idle detection follows the new rate
+    @param[in]  port UART number
+    @param[in]  baudRate New baud rate
+    @return True if baud rate is set
+*/
+bool hal_UartSetBaudRate(int port, uint32_t baudRate)
+{
+    return (uart_set_baudrate(port, baudRate) == ESP_OK);
+}
+
+
+/**
+    @brief  Get baud rate of open UART
+    @param[in]  port UART number
+    @return Baud rate, 0 on error
+*/
+uint32_t hal_UartGetBaudRate(int port)
+{
+    uint32_t baudRate;
+    if (uart_get_baudrate(port, &baudRate) != ESP_OK)
+        return 0;
+    return baudRate;
+}
@@ -0,0 +1,244 @@
+/**
+    @file
+    @brief   LED indication engine
+*/
+
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "hal.h"
+#include "led_indication.h"
+
+//------------ Definitions ----------//
+
+#define LED_INDIC_TASK_PRIORITY     2
+
+// Command word: type + 1 (0 - empty slot), repeats, on and off time [ms]
+#define LED_CMD_TYPE_POS            30
+#define LED_CMD_REPEATS_POS         24
+#define LED_CMD_ON_POS              12
+#define LED_CMD_OFF_POS             0
+#define LED_CMD_TIME_MASK           0xFFFu
+#define LED_CMD_REPEATS_MASK        0x3Fu
+
+typedef enum {
+    LedLayer_Main,
+    LedLayer_Alt,               // Overrides main indication while not off
+    LedLayer_Count
+} ledLayer_t;
+
+typedef struct {
+    LedIndication type;
+    uint8_t repeatsLeft;        // 0 - blink until other indication is set
+    uint16_t timeOn;            // [ms]
+    uint16_t timeOff;           // [ms]
+    bool isOn;
+    int64_t nextTime;           // Next blink transition [us]
+} ledState_t;
+
+//------------ Variables ------------//
+
+static atomic_uint ledCommands[LedCount][LedLayer_Count];      // Pending command, written by any task
+static atomic_uint ledActive[LedCount][LedLayer_Count];        // Command in effect, 0 when finished
+static ledState_t ledStates[LedCount][LedLayer_Count];         // Used by led_indication_task only
+static hal_Signal_t ledSignal;
+
+//------------ Externals ------------//
+
+//------------ Prototypes -----------//
+
+static void led_indication_task(void *pvParameters);
+
+//--------- Implementation ----------//
+
+
+/**
+    @brief  Init command slots, must be called before any indication is put
+    @return None
+*/
+void ledIndication_Init(void)
+{
+    ledSignal = hal_SignalCreate();
+}
+
+
+/**
+    @brief  Start indication task
+    @return None
+*/
+void ledIndication_Start(void)
+{
+    hal_TaskCreate(led_indication_task, "indication", 4096, 0, LED_INDIC_TASK_PRIORITY);
+}
+
+
+static uint32_t packCommand(LedIndication indicationType, uint16_t timeOn, uint16_t timeOff, uint8_t numRepeats)
+{
+    if (timeOn > LED_INDIC_MAX_TIME)
+        timeOn = LED_INDIC_MAX_TIME;
+    if (timeOff > LED_INDIC_MAX_TIME)
+        timeOff = LED_INDIC_MAX_TIME;
+    if (numRepeats > LED_INDIC_MAX_REPEATS)
+        numRepeats = LED_INDIC_MAX_REPEATS;
+    if (indicationType != LedIndic_Blink)
+        timeOn = timeOff = numRepeats = 0;
+    return ((uint32_t)(indicationType + 1) << LED_CMD_TYPE_POS) | ((uint32_t)numRepeats << LED_CMD_REPEATS_POS) |
+           ((uint32_t)timeOn << LED_CMD_ON_POS) | ((uint32_t)timeOff << LED_CMD_OFF_POS);
+}
+
+
+static void postCommand(Leds led, ledLayer_t layer, uint32_t command)
+{
+    // Same indication is running already (e.g. activity blink on every UART chunk) and no other one is
+    // pending. Task publishes ledActive before it empties the slot, so an empty slot means ledActive is current
+    if ((atomic_load(&ledCommands[led][layer]) == 0) && (atomic_load(&ledActive[led][layer]) == command))
+        return;
+    // Task is woken for the first pending command only, later ones replace it
+    if ((atomic_exchange(&ledCommands[led][layer], command) == 0) && ledSignal)
+        hal_SignalGive(ledSignal);
+}
+
+
+/**
+    @brief  Provide indication by LEDs
+    @param[in]  led Led to use
+    @param[in]  indicationType Desired indication type
+    @param[in]  timeOn Time [ms] for ON state (blink indication type only). May be 0 for ON or OFF indication
+    @param[in]  timeOff Time [ms] for OFF state (blink indication type only). May be 0 for ON or OFF indication
+    @param[in]  numRepeats Number of blinks. If set to 0, LED will blink until other indication type is set.
+                Otherwise LED will blink numRepeats times and then switch to OFF state
+    @return None
+*/
+void putLedIndication(Leds led, LedIndication indicationType, uint16_t timeOn, uint16_t timeOff, uint8_t numRepeats)
+{
+    postCommand(led, LedLayer_Main, packCommand(indicationType, timeOn, timeOff, numRepeats));
+}
+
+
+/**
+    @brief  Provide alternative indication by LEDs
+    @param[in]  led Led to use
+    @param[in]  indicationType Desired indication type. LedIndic_Off returns the LED to main indication
+    @param[in]  timeOn Time [ms] for ON state (blink indication type only). May be 0 for ON or OFF indication
+    @param[in]  timeOff Time [ms] for OFF state (blink indication type only). May be 0 for ON or OFF indication
+    @param[in]  numRepeats Number of blinks. If set to 0, LED will blink until other indication type is set.
+                Otherwise LED will blink numRepeats times and then switch to main indication
+    @return None
+*/
+void putAltLedIndication(Leds led, LedIndication indicationType, uint16_t timeOn, uint16_t timeOff, uint8_t numRepeats)
+{
+    postCommand(led, LedLayer_Alt, packCommand(indicationType, timeOn, timeOff, numRepeats));
+}
+
+
+/**
+    @brief  Start executing command
+    @param[out] s LED layer state
+    @param[in]  command Packed command
+    @param[in]  now Current time [us]
+    @return None
+*/
+static void applyCommand(ledState_t *s, uint32_t command, int64_t now)
+{
+    s->type = (LedIndication)((command >> LED_CMD_TYPE_POS) - 1);
+    s->repeatsLeft = (command >> LED_CMD_REPEATS_POS) & LED_CMD_REPEATS_MASK;
+    s->timeOn = (command >> LED_CMD_ON_POS) & LED_CMD_TIME_MASK;
+    s->timeOff = (command >> LED_CMD_OFF_POS) & LED_CMD_TIME_MASK;
+    if ((s->type == LedIndic_Blink) && (s->timeOn + s->timeOff == 0))
+        s->type = LedIndic_On;
+    // Blink starts with ON phase
+    s->isOn = (s->type != LedIndic_Off);
+    s->nextTime = now + s->timeOn * 1000ll;
+}
+
+
+/**
+    @brief  Advance blink to current time
+    @param[in,out]  s LED layer state
+    @param[in]  now Current time [us]
+    @return True if blink has finished
+*/
+static bool advanceBlink(ledState_t *s, int64_t now)
+{
+    while ((s->type == LedIndic_Blink) && (s->nextTime <= now))
+    {
+        if (s->isOn)
+        {
+            s->isOn = false;
+            s->nextTime += s->timeOff * 1000ll;
+        }
+        else if ((s->repeatsLeft > 0) && (--s->repeatsLeft == 0))
+        {
+            s->type = LedIndic_Off;
+            return true;
+        }
+        else
+        {
+            s->isOn = true;
+            s->nextTime += s->timeOn * 1000ll;
+        }
+    }
+    return false;
+}
+
+
+static void led_indication_task(void *pvParameters)
+{
+    LedState outputs[LedCount];
+    uint32_t led;
+    uint32_t layer;
+
+    drvLed_Init();
+    for (led = 0; led < LedCount; led++)
+    {
+        outputs[led] = Off;
+        drvLed_Set((Leds)led, Off);
+    }
+
+    while(1)
+    {
+        int64_t now = hal_GetTimeUs();
+        int64_t nextTime = INT64_MAX;
+
+        for (led = 0; led < LedCount; led++)
+        {
+            for (layer = 0; layer < LedLayer_Count; layer++)
+            {
+                ledState_t *s = &ledStates[led][layer];
+                uint32_t command = atomic_load(&ledCommands[led][layer]);
+                while (command)
+                {
+                    atomic_store(&ledActive[led][layer], command);
+                    // Command replaced in the meantime is skipped, the newer one is taken instead
+                    if (atomic_compare_exchange_strong(&ledCommands[led][layer], &command, 0))
+                    {
+                        applyCommand(s, command, now);
+                        break;
+                    }
+                }
+                if (advanceBlink(s, now))
+                    atomic_store(&ledActive[led][layer], 0);
+                if ((s->type == LedIndic_Blink) && (s->nextTime < nextTime))
+                    nextTime = s->nextTime;
+            }
+
+            const ledState_t *shown = (ledStates[led][LedLayer_Alt].type != LedIndic_Off) ?
+                                      &ledStates[led][LedLayer_Alt] : &ledStates[led][LedLayer_Main];
+            LedState output = shown->isOn ? On : Off;
+            if (output != outputs[led])
+            {
+                outputs[led] = output;
+                drvLed_Set((Leds)led, output);
+            }
+        }
+
+        // Sleep until the earliest blink transition or a new command
+        uint32_t waitMs = HAL_WAIT_FOREVER;
+        if (nextTime != INT64_MAX)
+        {
+            int64_t remaining = nextTime - hal_GetTimeUs();
+            waitMs = (remaining > 0) ? (uint32_t)((remaining + 999) / 1000) : 0;
+        }
+        hal_SignalWait(ledSignal, waitMs);
+    }
+}
@@ -0,0 +1,47 @@
+/**
+    @file
+    @brief   LED indication engine
+
+    Each LED has a main indication and an alternative one that overrides it
+    while active (e.g. a short activity blink over a steady state).
+
+    Any task may request an indication. A request is packed into a 32-bit
+    command and stored into the per-LED slot with a single atomic exchange;
+    a newer request replaces a pending one, and a request equal to the
+    indication already in effect is dropped, so repeated activity blinks
+    cost an atomic load. led_indication_task applies commands, computes the
+    next blink transition and sleeps until then or until a new command.
+*/
+
+#ifndef __LED_INDICATION_H__
+#define __LED_INDICATION_H__
+
+#include <stdint.h>
+
+#include "drv_led.h"
+
+#define LED_INDIC_MAX_TIME          4095    // Max blink on/off time [ms], longer times are clamped
+#define LED_INDIC_MAX_REPEATS       63      // Max number of blinks, larger values are clamped
+
+// LED indication types
+typedef enum {
+    LedIndic_Off,
+    LedIndic_On,
+    LedIndic_Blink,
+} LedIndication;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    void ledIndication_Init(void);
+    void ledIndication_Start(void);
+    void putLedIndication(Leds led, LedIndication indicationType, uint16_t timeOn, uint16_t timeOff, uint8_t numRepeats);
+    void putAltLedIndication(Leds led, LedIndication indicationType, uint16_t timeOn, uint16_t timeOff, uint8_t numRepeats);
+
+#ifdef __cplusplus
+}   // extern "C"
+#endif
+
+#endif // __LED_INDICATION_H__
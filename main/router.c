@@ -0,0 +1,135 @@
+/**
+    @file
+    @brief   Table-driven data routing between bridge channels
+*/
+
+#include <stdatomic.h>
+
+#include "hal.h"
+#include "router.h"
+
+//------------ Definitions ----------//
+
+//------------ Variables ------------//
+
+static const char *ROUTER_TAG = "Router";
+
+static const router_Channel_t *routerChannels;
+static const router_Route_t *routerRoutes;
+static uint8_t sourceRoutes[ROUTER_MAX_CHANNELS][ROUTER_MAX_ROUTES];   // Route indexes of each source
+static uint8_t sourceRouteCount[ROUTER_MAX_CHANNELS];
+static atomic_uint routerFlags;
+
+//------------ Externals ------------//
+
+//------------ Prototypes -----------//
+
+//--------- Implementation ----------//
+
+
+static inline void addStat(bridgeStat_t id, uint32_t value)
+{
+    if ((id < ROUTER_NO_STAT) && (value > 0))
+        bridgeStats_Add(id, value);
+}
+
+
+/**
+    @brief  Check tables and build route lists of sources
+            Tables must stay valid while router is used
+    @param[in]  channels Channel table
+    @param[in]  channelCount Number of channels, up to ROUTER_MAX_CHANNELS
+    @param[in]  routes Route table, routes of the same source are used in table order
+    @param[in]  routeCount Number of routes, up to ROUTER_MAX_ROUTES
+    @return True if tables are valid
+*/
+bool router_Init(const router_Channel_t *channels, uint32_t channelCount,
+                 const router_Route_t *routes, uint32_t routeCount)
+{
+    uint32_t i;
+
+    if ((channelCount > ROUTER_MAX_CHANNELS) || (routeCount > ROUTER_MAX_ROUTES))
+    {
+        HAL_LOGE(ROUTER_TAG, "Too many channels or routes");
+        return false;
+    }
+    for (i = 0; i < ROUTER_MAX_CHANNELS; i++)
+        sourceRouteCount[i] = 0;
+    for (i = 0; i < routeCount; i++)
+    {
+        const router_Route_t *r = &routes[i];
+        if ((r->source >= channelCount) || (r->sink >= channelCount) || !channels[r->sink].write)
+        {
+            HAL_LOGE(ROUTER_TAG, "Invalid route %u", (unsigned)i);
+            return false;
+        }
+        sourceRoutes[r->source][sourceRouteCount[r->source]++] = i;
+    }
+    routerChannels = channels;
+    routerRoutes = routes;
+    return true;
+}
+
+
+/**
+    @brief  Pass data read from source channel to all enabled sinks
+    @param[in]  source Source channel index
+    @param[in]  buf Data, caller keeps its reference
+    @return True if every enabled route accepted all data
+*/
+bool router_Forward(uint32_t source, bufferPool_Buffer_t *buf)
+{
+    uint32_t len = buf->len;
+    uint32_t flags = atomic_load_explicit(&routerFlags, memory_order_relaxed);
+    bool isAccepted = true;
+    uint32_t i;
+
+    for (i = 0; i < sourceRouteCount[source]; i++)
+    {
+        const router_Route_t *r = &routerRoutes[sourceRoutes[source][i]];
+        if ((flags & r->flagsMask) != r->flagsValue)
+        {
+            addStat(r->statSkipped, len);
+            continue;
+        }
+        const router_Channel_t *sink = &routerChannels[r->sink];
+        uint32_t written = sink->write(sink->ctx, buf);
+        addStat(r->statBytes, written);
+        addStat(r->statDropped, len - written);
+        if (written < len)
+            isAccepted = false;
+    }
+    return isAccepted;
+}
+
+
+/**
+    @brief  Set route condition flags
+    @param[in]  flags Flags to set
+    @return Flags before the call
+*/
+uint32_t router_SetFlags(uint32_t flags)
+{
+    return atomic_fetch_or(&routerFlags, flags);
+}
+
+
+/**
+    @brief  Clear route condition flags
+    @param[in]  flags Flags to clear
+    @return None
+*/
+void router_ClearFlags(uint32_t flags)
+{
+    atomic_fetch_and(&routerFlags, ~flags);
+}
+
+
+/**
+    @brief  Get route condition flags
+    @return Flags
+*/
+uint32_t router_GetFlags(void)
+{
+    return atomic_load(&routerFlags);
+}
@@ -0,0 +1,65 @@
+/**
+    @file
+    @brief   Table-driven data routing between bridge channels
+
+    A channel is a UART link or a UDP endpoint. Each channel may act as a
+    source (data read from it is passed to router_Forward) and as a sink
+    (router calls its write function). Routes connect a source to a sink
+    and are enabled by a condition on the router flags, e.g. telemetry is
+    not forwarded to the AAT UART while a configurator session is active.
+
+    Routes of each source are resolved into an index list by router_Init,
+    so forwarding is a walk over that list. All sinks get the same pool
+    buffer; a sink that queues data takes a reference with bufferPool_Ref()
+    instead of copying it, copying into a driver or FIFO is up to the sink.
+*/
+
+#ifndef __ROUTER_H__
+#define __ROUTER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "bridge_stats.h"
+#include "buffer_pool.h"
+
+#define ROUTER_MAX_CHANNELS         8
+#define ROUTER_MAX_ROUTES           16
+#define ROUTER_NO_STAT              BridgeStat_Count    // Route does not update this counter
+
+// Sink write function, returns number of bytes of buf accepted
+typedef uint32_t (*router_SinkWrite_t)(void *ctx, bufferPool_Buffer_t *buf);
+
+typedef struct {
+    const char *name;
+    router_SinkWrite_t write;       // NULL if channel is a source only
+    void *ctx;
+} router_Channel_t;
+
+typedef struct {
+    uint8_t source;                 // Index into channel table
+    uint8_t sink;                   // Index into channel table
+    uint32_t flagsMask;             // Route is enabled when (flags & flagsMask) == flagsValue
+    uint32_t flagsValue;
+    bridgeStat_t statBytes;         // Bytes accepted by sink
+    bridgeStat_t statDropped;       // Bytes not accepted by sink
+    bridgeStat_t statSkipped;       // Bytes not offered, route is disabled
+} router_Route_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    bool router_Init(const router_Channel_t *channels, uint32_t channelCount,
+                     const router_Route_t *routes, uint32_t routeCount);
+    bool router_Forward(uint32_t source, bufferPool_Buffer_t *buf);
+    uint32_t router_SetFlags(uint32_t flags);
+    void router_ClearFlags(uint32_t flags);
+    uint32_t router_GetFlags(void);
+
+#ifdef __cplusplus
+}   // extern "C"
+#endif
+
+#endif // __ROUTER_H__
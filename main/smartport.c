@@ -0,0 +1,158 @@
+/**
+    @file
+    @brief   SmartPort stream decoder
+
+    Decodes a raw SmartPort byte stream (as output by a receiver or a TX module)
+    into frames. Each frame starts with SPORT_START_BYTE followed by physical ID.
+    A poll that is answered by a sensor is followed by SPORT_PAYLOAD_SIZE payload
+    bytes, where SPORT_START_BYTE and SPORT_BYTESTUFF are escaped by SPORT_BYTESTUFF
+    and XOR'ed with SPORT_STUFF_MASK. Last payload byte is CRC.
+
+    Valid frames are returned in the form they were received, so they can be
+    forwarded without re-encoding.
+*/
+
+#include <string.h>
+#include "smartport.h"
+
+//------------ Definitions ----------//
+
+//------------ Variables ------------//
+
+//------------ Externals ------------//
+
+//------------ Prototypes -----------//
+
+//--------- Implementation ----------//
+
+
+/**
+    @brief  Init decoder
+    @param[in]  d Decoder instance
+    @return None
+*/
+void sportDecoder_Init(sportDecoder_t *d)
+{
+    memset(d, 0, sizeof(*d));
+}
+
+
+/**
+    @brief  Check SmartPort payload CRC
+    @param[in]  payload Unstuffed payload, SPORT_PAYLOAD_SIZE bytes, CRC is the last one
+    @return True if CRC is valid
+*/
+bool sport_CheckCrc(const uint8_t *payload)
+{
+    uint16_t crc = 0;
+    uint8_t i;
+    for (i = 0; i < SPORT_PAYLOAD_SIZE; i++)
+    {
+        crc += payload[i];
+        crc += crc >> 8;
+        crc &= 0xFF;
+    }
+    return (crc == 0xFF);
+}
+
+
+/**
+    @brief  Start new frame
+    @param[in]  d Decoder instance
+    @return None
+*/
+static void sportDecoder_StartFrame(sportDecoder_t *d)
+{
+    // Frame which is interrupted by start byte after physical ID is either a poll
+    // without response or a truncated frame
+    if (d->inFrame && d->hasPhysId)
+    {
+        if (d->payloadLen == 0)
+            d->stats.polls++;
+        else
+            d->stats.framingErrors++;
+    }
+    d->raw[0] = SPORT_START_BYTE;
+    d->rawLen = 1;
+    d->payloadLen = 0;
+    d->inFrame = true;
+    d->hasPhysId = false;
+    d->escape = false;
+}
+
+
+/**
+    @brief  Put received byte into decoder
+    @param[in]  d Decoder instance
+    @param[in]  byte Received byte
+    @return SportDecoder_Frame if a valid frame is complete. Frame is available
+            in d->raw (d->rawLen bytes) until next call.
+*/
+sportDecoderResult_t sportDecoder_PutByte(sportDecoder_t *d, uint8_t byte)
+{
+    if (byte == SPORT_START_BYTE)
+    {
+        sportDecoder_StartFrame(d);
+        return SportDecoder_InProgress;
+    }
+    if (!d->inFrame)
+    {
+        // Waiting for synchronization
+        return SportDecoder_InProgress;
+    }
+
+    d->raw[d->rawLen++] = byte;
+    if (byte == SPORT_BYTESTUFF)
+    {
+        if (d->escape)
+        {
+            // Double escape is not allowed
+            d->stats.framingErrors++;
+            d->inFrame = false;
+        }
+        d->escape = true;
+        return SportDecoder_InProgress;
+    }
+    if (d->escape)
+    {
+        byte ^= SPORT_STUFF_MASK;
+        d->escape = false;
+    }
+
+    if (!d->hasPhysId)
+    {
+        d->physId = byte;
+        d->hasPhysId = true;
+        return SportDecoder_InProgress;
+    }
+
+    d->payload[d->payloadLen++] = byte;
+    if (d->payloadLen < SPORT_PAYLOAD_SIZE)
+        return SportDecoder_InProgress;
+
+    // Frame is complete, next one is expected to begin with start byte
+    d->inFrame = false;
+    if (!sport_CheckCrc(d->payload))
+    {
+        d->stats.crcErrors++;
+        return SportDecoder_InProgress;
+    }
+    d->stats.frames++;
+    return SportDecoder_Frame;
+}
+
+
+/**
+    @brief  Check if last received bytes are a poll that is not answered yet
+            When the line goes idle in this state, the polled sensor slot is free
+    @param[in]  d Decoder instance
+    @param[out]  physId Polled physical ID (with check bits), valid if true is returned
+    @return True if poll is pending
+*/
+bool sportDecoder_IsPollPending(const sportDecoder_t *d, uint8_t *physId)
+{
+    if (!d->inFrame || !d->hasPhysId || (d->payloadLen != 0) || d->escape)
+        return false;
+    *physId = d->physId;
+    return true;
+}
@@ -0,0 +1,55 @@
+/**
+    @file
+    @brief   SmartPort stream decoder
+*/
+
+#ifndef __SMARTPORT_H__
+#define __SMARTPORT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SPORT_START_BYTE            0x7E
+#define SPORT_BYTESTUFF             0x7D
+#define SPORT_STUFF_MASK            0x20
+
+#define SPORT_PAYLOAD_SIZE          8       // Frame header, data ID (2), value (4), CRC
+#define SPORT_MAX_RAW_FRAME_SIZE    (1 + 2 * (1 + SPORT_PAYLOAD_SIZE))   // Start byte, stuffed physical ID and payload
+
+typedef enum {
+    SportDecoder_InProgress,    // Byte is consumed, frame is not complete yet
+    SportDecoder_Frame,         // Valid frame is available in raw[]
+} sportDecoderResult_t;
+
+typedef struct {
+    uint8_t raw[SPORT_MAX_RAW_FRAME_SIZE];      // Frame bytes as received (with start byte and stuffing)
+    uint8_t rawLen;
+    uint8_t physId;
+    uint8_t payload[SPORT_PAYLOAD_SIZE];        // Unstuffed payload
+    uint8_t payloadLen;
+    bool inFrame;
+    bool hasPhysId;
+    bool escape;
+    struct {
+        uint32_t frames;            // Valid data frames
+        uint32_t polls;             // Polls without response
+        uint32_t crcErrors;
+        uint32_t framingErrors;     // Truncated frames, bad stuffing
+    } stats;
+} sportDecoder_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    void sportDecoder_Init(sportDecoder_t *d);
+    sportDecoderResult_t sportDecoder_PutByte(sportDecoder_t *d, uint8_t byte);
+    bool sportDecoder_IsPollPending(const sportDecoder_t *d, uint8_t *physId);
+    bool sport_CheckCrc(const uint8_t *payload);
+
+#ifdef __cplusplus
+}   // extern "C"
+#endif
+
+#endif // __SMARTPORT_H__
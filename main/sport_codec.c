@@ -0,0 +1,508 @@
+/**
+    @file
+    @brief   Compressed SmartPort downlink codec
+*/
+
+#include <string.h>
+#include "sport_codec.h"
+
+//------------ Definitions ----------//
+
+#define RECORD_DELTA                0x00
+#define RECORD_SAME                 0x40
+#define RECORD_FRAME                0x80
+#define RECORD_LITERAL              0x81
+#define RECORD_DICTIONARY           0x82
+#define RECORD_SLOT_MASK            0x3F
+#define RECORD_KIND_MASK            0xC0
+
+#define VARINT_MAX_SIZE             5
+
+//------------ Variables ------------//
+
+//------------ Externals ------------//
+
+//------------ Prototypes -----------//
+
+//--------- Implementation ----------//
+
+
+static inline uint32_t slotKey(uint8_t physId, const uint8_t *payload)
+{
+    return ((uint32_t)physId << 24) | ((uint32_t)payload[0] << 16) | payload[1] | ((uint32_t)payload[2] << 8);
+}
+
+
+static inline uint32_t payloadValue(const uint8_t *payload)
+{
+    return payload[3] | (payload[4] << 8) | (payload[5] << 16) | ((uint32_t)payload[6] << 24);
+}
+
+
+static uint32_t putVarint(uint8_t *out, uint32_t value)
+{
+    uint32_t len = 0;
+    while (value >= 0x80)
+    {
+        out[len++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    out[len++] = value;
+    return len;
+}
+
+
+/**
+    @brief  Read varint
+    @param[in]  in Input
+    @param[in]  inLen Input length
+    @param[out] value Value
+    @return Number of bytes read, 0 if varint is truncated or too long
+*/
+static uint32_t getVarint(const uint8_t *in, uint32_t inLen, uint32_t *value)
+{
+    uint32_t result = 0;
+    uint32_t i;
+
+    for (i = 0; (i < inLen) && (i < VARINT_MAX_SIZE); i++)
+    {
+        result |= (uint32_t)(in[i] & 0x7F) << (7 * i);
+        if ((in[i] & 0x80) == 0)
+        {
+            *value = result;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+
+/**
+    @brief  Write frame or dictionary entry record
+    @param[out] out Record, SPORT_CODEC_MAX_DICTIONARY_SIZE / SPORT_CODEC_MAX_SLOTS bytes at most
+    @param[in]  tag RECORD_FRAME or RECORD_DICTIONARY
+    @param[in]  key Slot key
+    @param[in]  value Frame or reference value
+    @return Record length
+*/
+static uint32_t putEntry(uint8_t *out, uint8_t tag, uint32_t key, uint32_t value)
+{
+    out[0] = tag;
+    out[1] = key >> 24;
+    out[2] = key >> 16;
+    out[3] = key;
+    out[4] = key >> 8;
+    return 5 + putVarint(&out[5], value);
+}
+
+
+/**
+    @brief  Read fields of frame or dictionary entry record
+    @param[in]  in Record after the tag
+    @param[in]  inLen Input length
+    @param[out] key Slot key
+    @param[out] value Frame or reference value
+    @return Number of bytes read, 0 if record is truncated
+*/
+static uint32_t getEntry(const uint8_t *in, uint32_t inLen, uint32_t *key, uint32_t *value)
+{
+    uint32_t n;
+
+    if ((inLen < 4) || ((n = getVarint(&in[4], inLen - 4, value)) == 0))
+        return 0;
+    *key = ((uint32_t)in[0] << 24) | ((uint32_t)in[1] << 16) | in[2] | ((uint32_t)in[3] << 8);
+    return 4 + n;
+}
+
+
+static inline uint32_t putStuffed(uint8_t *out, uint8_t byte)
+{
+    if ((byte == SPORT_START_BYTE) || (byte == SPORT_BYTESTUFF))
+    {
+        out[0] = SPORT_BYTESTUFF;
+        out[1] = byte ^ SPORT_STUFF_MASK;
+        return 2;
+    }
+    out[0] = byte;
+    return 1;
+}
+
+
+/**
+    @brief  Build frame the way sensors send it: start byte, stuffed physical ID and payload, CRC
+    @param[out] out Frame, at least SPORT_MAX_RAW_FRAME_SIZE bytes
+    @param[in]  key Slot key
+    @param[in]  value Frame value
+    @return Frame length
+*/
+static uint32_t buildFrame(uint8_t *out, uint32_t key, uint32_t value)
+{
+    uint8_t payload[SPORT_PAYLOAD_SIZE];
+    uint16_t crc = 0;
+    uint32_t len = 0;
+    uint32_t i;
+
+    payload[0] = key >> 16;
+    payload[1] = key;
+    payload[2] = key >> 8;
+    payload[3] = value;
+    payload[4] = value >> 8;
+    payload[5] = value >> 16;
+    payload[6] = value >> 24;
+    for (i = 0; i < SPORT_PAYLOAD_SIZE - 1; i++)
+    {
+        crc += payload[i];
+        crc += crc >> 8;
+        crc &= 0xFF;
+    }
+    payload[SPORT_PAYLOAD_SIZE - 1] = 0xFF - crc;
+
+    out[len++] = SPORT_START_BYTE;
+    len += putStuffed(&out[len], key >> 24);
+    for (i = 0; i < SPORT_PAYLOAD_SIZE; i++)
+        len += putStuffed(&out[len], payload[i]);
+    return len;
+}
+
+
+/**
+    @brief  Unstuff frame
+    @param[in]  raw Frame as received
+    @param[in]  rawLen Frame length
+    @param[out] physId Physical ID
+    @param[out] payload Payload, SPORT_PAYLOAD_SIZE bytes
+    @return True if frame is complete
+*/
+static bool parseFrame(const uint8_t *raw, uint32_t rawLen, uint8_t *physId, uint8_t *payload)
+{
+    uint32_t count = 0;
+    uint32_t i;
+
+    if ((rawLen < 2 + SPORT_PAYLOAD_SIZE) || (raw[0] != SPORT_START_BYTE))
+        return false;
+    for (i = 1; i < rawLen; i++)
+    {
+        uint8_t byte = raw[i];
+        if (byte == SPORT_BYTESTUFF)
+        {
+            if (++i == rawLen)
+                return false;
+            byte = raw[i] ^ SPORT_STUFF_MASK;
+        }
+        if (count == 0)
+            *physId = byte;
+        else if (count <= SPORT_PAYLOAD_SIZE)
+            payload[count - 1] = byte;
+        count++;
+    }
+    return (count == 1 + SPORT_PAYLOAD_SIZE);
+}
+
+
+/**
+    @brief  Init encoder, first datagram is a key one
+    @param[in]  e Encoder instance
+    @return None
+*/
+void sportEncoder_Init(sportEncoder_t *e)
+{
+    memset(e, 0, sizeof(*e));
+    e->isKeyPending = true;
+}
+
+
+/**
+    @brief  Send the dictionary with the next datagram, references are the last values of sensors
+            Lets decoders that lost the key datagram or joined late synchronize
+    @param[in]  e Encoder instance
+    @return None
+*/
+void sportEncoder_Reset(sportEncoder_t *e)
+{
+    e->isKeyPending = true;
+}
+
+
+/**
+    @brief  Start datagram, a key datagram starts with the dictionary
+    @param[in]  e Encoder instance
+    @param[out] out Datagram header, SPORT_CODEC_HEADER_SIZE + SPORT_CODEC_MAX_DICTIONARY_SIZE bytes at most
+    @return Header length
+*/
+uint32_t sportEncoder_Begin(sportEncoder_t *e, uint8_t *out)
+{
+    uint32_t len = SPORT_CODEC_HEADER_SIZE;
+    uint32_t count = 0;
+    uint32_t i;
+
+    out[0] = SPORT_CODEC_MAGIC;
+    out[1] = e->seq;
+    if (e->isKeyPending)
+    {
+        // Sensors not seen for a while are dropped, the others keep their order
+        for (i = 0; i < e->slotCount; i++)
+        {
+            if (e->idleKeys[i] >= SPORT_CODEC_SLOT_MAX_IDLE)
+                continue;
+            e->slots[count].key = e->slots[i].key;
+            e->slots[count].value = e->lastValues[i];
+            e->lastValues[count] = e->lastValues[i];
+            e->idleKeys[count] = e->idleKeys[i] + 1;
+            len += putEntry(&out[len], RECORD_DICTIONARY, e->slots[count].key, e->slots[count].value);
+            count++;
+        }
+        e->slotCount = count;
+        e->keyedCount = count;
+        e->keySeq = e->seq;
+        out[0] |= SPORT_CODEC_FLAG_KEY;
+        e->isKeyPending = false;
+        e->stats.keys++;
+    }
+    out[2] = e->keySeq;
+    e->seq++;
+    e->stats.datagrams++;
+    return len;
+}
+
+
+/**
+    @brief  Check for sensors seen since the last key, they are sent as whole frames until the next one
+    @param[in]  e Encoder instance
+    @return True if a key datagram would add slots to the dictionary
+*/
+bool sportEncoder_HasNewSlots(const sportEncoder_t *e)
+{
+    return e->slotCount > e->keyedCount;
+}
+
+
+/**
+    @brief  Encode frame into current datagram
+    @param[in]  e Encoder instance
+    @param[in]  raw Frame as received, or any bytes (they are sent as literals)
+    @param[in]  rawLen Length
+    @param[out] out Record, rawLen + 2 * (rawLen / SPORT_CODEC_MAX_LITERAL + 1) bytes at most
+    @return Record length
+*/
+uint32_t sportEncoder_PutFrame(sportEncoder_t *e, const uint8_t *raw, uint32_t rawLen, uint8_t *out)
+{
+    uint8_t canonical[SPORT_MAX_RAW_FRAME_SIZE];
+    uint8_t payload[SPORT_PAYLOAD_SIZE];
+    uint8_t physId;
+    uint32_t len = 0;
+    uint32_t i;
+
+    e->stats.frames++;
+    if (parseFrame(raw, rawLen, &physId, payload))
+    {
+        uint32_t key = slotKey(physId, payload);
+        uint32_t value = payloadValue(payload);
+
+        // Frames with non-minimal stuffing or the other valid CRC are not rebuilt exactly
+        if ((buildFrame(canonical, key, value) == rawLen) && (memcmp(canonical, raw, rawLen) == 0))
+        {
+            for (i = 0; i < e->slotCount; i++)
+            {
+                if (e->slots[i].key == key)
+                    break;
+            }
+            if ((i == e->slotCount) && (e->slotCount < SPORT_CODEC_MAX_SLOTS))
+            {
+                // New sensor, it gets into the dictionary with the next key
+                e->slots[i].key = key;
+                e->slotCount++;
+            }
+            if (i < e->slotCount)
+            {
+                e->lastValues[i] = value;
+                e->idleKeys[i] = 0;
+            }
+            if (i < e->keyedCount)
+            {
+                int32_t delta = (int32_t)(value - e->slots[i].value);
+                if (delta == 0)
+                {
+                    out[len++] = RECORD_SAME | i;
+                    return len;
+                }
+                out[len++] = RECORD_DELTA | i;
+                len += putVarint(&out[len], ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+                return len;
+            }
+            return putEntry(out, RECORD_FRAME, key, value);
+        }
+    }
+
+    e->stats.literals++;
+    while (rawLen > 0)
+    {
+        uint32_t chunk = (rawLen > SPORT_CODEC_MAX_LITERAL) ? SPORT_CODEC_MAX_LITERAL : rawLen;
+        out[len++] = RECORD_LITERAL;
+        out[len++] = chunk;
+        memcpy(&out[len], raw, chunk);
+        len += chunk;
+        raw += chunk;
+        rawLen -= chunk;
+    }
+    return len;
+}
+
+
+/**
+    @brief  Init decoder, it waits for a key datagram
+    @param[in]  d Decoder instance
+    @return None
+*/
+void sportCodecDecoder_Init(sportCodecDecoder_t *d)
+{
+    memset(d, 0, sizeof(*d));
+}
+
+
+/**
+    @brief  Decode records of a datagram
+    @param[in]  d Decoder instance
+    @param[in]  in Records
+    @param[in]  inLen Records length
+    @param[in,out]  slots Dictionary, entries of a key datagram are added to it
+    @param[in,out]  slotCount Number of slots
+    @param[in]  isKey Datagram is a key one, dictionary entries are allowed
+    @param[out] out Frames
+    @param[in]  outSize Size of out
+    @param[out] outLen Frames length
+    @return True if all records are valid and fit into out
+*/
+static bool decodeRecords(sportCodecDecoder_t *d, const uint8_t *in, uint32_t inLen,
+                          sportCodec_Slot_t *slots, uint32_t *slotCount, bool isKey,
+                          uint8_t *out, uint32_t outSize, uint32_t *outLen)
+{
+    uint8_t frame[SPORT_MAX_RAW_FRAME_SIZE];
+    uint32_t pos = 0;
+    uint32_t len = 0;
+
+    while (pos < inLen)
+    {
+        uint8_t tag = in[pos++];
+        const uint8_t *data = frame;
+        uint32_t dataLen;
+
+        if (tag == RECORD_LITERAL)
+        {
+            if ((pos == inLen) || (in[pos] > inLen - pos - 1))
+                return false;
+            dataLen = in[pos++];
+            data = &in[pos];
+            pos += dataLen;
+        }
+        else if (tag == RECORD_DICTIONARY)
+        {
+            if (!isKey || (*slotCount == SPORT_CODEC_MAX_SLOTS))
+                return false;
+            sportCodec_Slot_t *slot = &slots[*slotCount];
+            uint32_t n = getEntry(&in[pos], inLen - pos, &slot->key, &slot->value);
+            if (n == 0)
+                return false;
+            pos += n;
+            (*slotCount)++;
+            continue;
+        }
+        else if (tag == RECORD_FRAME)
+        {
+            uint32_t key;
+            uint32_t value;
+            uint32_t n = getEntry(&in[pos], inLen - pos, &key, &value);
+            if (n == 0)
+                return false;
+            pos += n;
+            dataLen = buildFrame(frame, key, value);
+        }
+        else if ((tag & RECORD_KIND_MASK) <= RECORD_SAME)
+        {
+            uint32_t index = tag & RECORD_SLOT_MASK;
+            uint32_t value;
+            if (index >= *slotCount)
+                return false;
+            value = slots[index].value;
+            if ((tag & RECORD_KIND_MASK) == RECORD_DELTA)
+            {
+                uint32_t zigzag;
+                uint32_t n = getVarint(&in[pos], inLen - pos, &zigzag);
+                if (n == 0)
+                    return false;
+                pos += n;
+                value += (zigzag >> 1) ^ (0 - (zigzag & 1));
+            }
+            dataLen = buildFrame(frame, slots[index].key, value);
+        }
+        else
+        {
+            return false;
+        }
+
+        if (dataLen > outSize - len)
+            return false;
+        memcpy(&out[len], data, dataLen);
+        len += dataLen;
+        d->stats.frames++;
+    }
+    *outLen = len;
+    return true;
+}
+
+
+/**
+    @brief  Decode datagram into the frames it was encoded from
+    @param[in]  d Decoder instance
+    @param[in]  in Datagram
+    @param[in]  inLen Datagram length
+    @param[out] out Frames as received by the encoder side
+    @param[in]  outSize Size of out, (inLen - SPORT_CODEC_HEADER_SIZE) * SPORT_MAX_RAW_FRAME_SIZE always fits
+    @param[out] outLen Frames length, 0 unless SportCodec_Ok is returned
+    @return Result
+*/
+sportCodecResult_t sportCodecDecoder_Decode(sportCodecDecoder_t *d, const uint8_t *in, uint32_t inLen,
+                                            uint8_t *out, uint32_t outSize, uint32_t *outLen)
+{
+    sportCodec_Slot_t keySlots[SPORT_CODEC_MAX_SLOTS];
+    uint32_t keySlotCount = 0;
+    bool isKey;
+
+    *outLen = 0;
+    if ((inLen < SPORT_CODEC_HEADER_SIZE) || ((in[0] & SPORT_CODEC_MAGIC_MASK) != SPORT_CODEC_MAGIC))
+    {
+        d->stats.invalid++;
+        return SportCodec_Invalid;
+    }
+    d->stats.datagrams++;
+
+    // Datagrams reordered by the network look like a gap of almost 256, they are not counted
+    uint8_t gap = in[1] - d->seq;
+    if (d->isSeqKnown && (gap < 128))
+        d->stats.lost += gap;
+    d->seq = in[1] + 1;
+    d->isSeqKnown = true;
+
+    isKey = (in[0] & SPORT_CODEC_FLAG_KEY) != 0;
+    if (!isKey && (!d->isSynced || (in[2] != d->keySeq)))
+    {
+        d->stats.skipped++;
+        return SportCodec_Skipped;
+    }
+    if ((isKey && (in[2] != in[1])) ||
+        !decodeRecords(d, &in[SPORT_CODEC_HEADER_SIZE], inLen - SPORT_CODEC_HEADER_SIZE,
+                       isKey ? keySlots : d->slots, isKey ? &keySlotCount : &d->slotCount, isKey,
+                       out, outSize, outLen))
+    {
+        *outLen = 0;
+        d->stats.invalid++;
+        return SportCodec_Invalid;
+    }
+    if (isKey)
+    {
+        memcpy(d->slots, keySlots, keySlotCount * sizeof(keySlots[0]));
+        d->slotCount = keySlotCount;
+        d->keySeq = in[1];
+        d->isSynced = true;
+    }
+    return SportCodec_Ok;
+}
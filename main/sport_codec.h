@@ -0,0 +1,118 @@
+/**
+    @file
+    @brief   Compressed SmartPort downlink codec
+
+    SmartPort telemetry repeats the same sensors every polling cycle with
+    slowly changing values. The encoder keeps a dictionary of sensors
+    (physical ID, frame header and data ID) with a reference value each and
+    sends each frame as a slot index and the zigzag varint delta of its value
+    against the reference. The decoder rebuilds the frames as received: start
+    byte, byte stuffing and CRC are derived, frames that would not be
+    rebuilt exactly are sent as literals.
+
+    Datagram: header (3 bytes) and records.
+        Header: SPORT_CODEC_MAGIC | flags, sequence number, sequence number of
+                the key datagram the records refer to (both wrap at 256).
+        Records:
+            0x00..0x3F  slot, value delta against reference (zigzag varint, non-zero)
+            0x40..0x7F  slot, value equals reference
+            0x80        frame: physical ID, frame header, data ID (2 bytes LE), value (varint)
+            0x81        literal: length (1 byte), bytes as received
+            0x82        dictionary entry, key datagrams only: physical ID, frame header,
+                        data ID (2 bytes LE), reference value (varint), no frame is output
+
+    Key datagrams (SPORT_CODEC_FLAG_KEY) start with the whole dictionary, the
+    entries get slot indexes in the order they are sent. The dictionary and
+    the reference values stay fixed until the next key datagram, so every
+    datagram can be decoded with its key alone: a lost datagram costs only
+    itself, a lost key costs the datagrams up to the next key. Sensors that
+    show up between keys are sent as 0x80 frames and get a slot with the next
+    key. The encoder owner sends keys periodically via sportEncoder_Reset().
+*/
+
+#ifndef __SPORT_CODEC_H__
+#define __SPORT_CODEC_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "smartport.h"
+
+#define SPORT_CODEC_MAGIC           0xA0
+#define SPORT_CODEC_MAGIC_MASK      0xFE
+#define SPORT_CODEC_FLAG_KEY        0x01    // Datagram carries a new dictionary
+#define SPORT_CODEC_HEADER_SIZE     3
+#define SPORT_CODEC_MAX_SLOTS       64
+#define SPORT_CODEC_MAX_LITERAL     255
+#define SPORT_CODEC_SLOT_MAX_IDLE   4       // Sensor is dropped from dictionary if not seen for this many keys
+#define SPORT_CODEC_MAX_DICTIONARY_SIZE     (SPORT_CODEC_MAX_SLOTS * 10)
+
+// Max encoded size of rawLen bytes of frames: the dictionary of a key datagram, and a literal adds
+// 2 bytes to each frame (10 bytes at least) and to a cut frame at the start
+#define SPORT_CODEC_MAX_ENCODED_SIZE(rawLen)    (SPORT_CODEC_HEADER_SIZE + SPORT_CODEC_MAX_DICTIONARY_SIZE + \
+                                                 (rawLen) + 2 * ((rawLen) / (2 + SPORT_PAYLOAD_SIZE) + 1))
+
+typedef enum {
+    SportCodec_Ok,
+    SportCodec_Skipped,         // Key datagram it refers to was not received, nothing is output
+    SportCodec_Invalid,         // Not a codec datagram or corrupt
+} sportCodecResult_t;
+
+typedef struct {
+    uint32_t key;               // Physical ID << 24 | frame header << 16 | data ID
+    uint32_t value;             // Reference value
+} sportCodec_Slot_t;
+
+typedef struct {
+    sportCodec_Slot_t slots[SPORT_CODEC_MAX_SLOTS];
+    uint32_t lastValues[SPORT_CODEC_MAX_SLOTS];     // Sent with the next key
+    uint8_t idleKeys[SPORT_CODEC_MAX_SLOTS];        // Keys since the sensor was seen
+    uint32_t slotCount;
+    uint32_t keyedCount;        // Slots 0..keyedCount - 1 are in the dictionary of the last key
+    uint8_t seq;                // Next datagram
+    uint8_t keySeq;
+    bool isKeyPending;
+    struct {
+        uint32_t datagrams;
+        uint32_t keys;
+        uint32_t frames;
+        uint32_t literals;
+    } stats;
+} sportEncoder_t;
+
+typedef struct {
+    sportCodec_Slot_t slots[SPORT_CODEC_MAX_SLOTS];     // Dictionary of the last key
+    uint32_t slotCount;
+    uint8_t seq;                // Expected datagram
+    uint8_t keySeq;
+    bool isSynced;              // A key datagram was decoded
+    bool isSeqKnown;
+    struct {
+        uint32_t datagrams;
+        uint32_t frames;
+        uint32_t lost;          // Datagrams missing in sequence
+        uint32_t skipped;       // Datagrams not decoded, their key was not received
+        uint32_t invalid;
+    } stats;
+} sportCodecDecoder_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    void sportEncoder_Init(sportEncoder_t *e);
+    void sportEncoder_Reset(sportEncoder_t *e);
+    uint32_t sportEncoder_Begin(sportEncoder_t *e, uint8_t *out);
+    bool sportEncoder_HasNewSlots(const sportEncoder_t *e);
+    uint32_t sportEncoder_PutFrame(sportEncoder_t *e, const uint8_t *raw, uint32_t rawLen, uint8_t *out);
+
+    void sportCodecDecoder_Init(sportCodecDecoder_t *d);
+    sportCodecResult_t sportCodecDecoder_Decode(sportCodecDecoder_t *d, const uint8_t *in, uint32_t inLen,
+                                                uint8_t *out, uint32_t outSize, uint32_t *outLen);
+
+#ifdef __cplusplus
+}   // extern "C"
+#endif
+
+#endif // __SPORT_CODEC_H__
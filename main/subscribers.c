@@ -0,0 +1,115 @@
+/**
+    @file
+    @brief   Telemetry downlink subscriber table
+*/
+
+#include "subscribers.h"
+
+//------------ Definitions ----------//
+
+//------------ Variables ------------//
+
+//------------ Externals ------------//
+
+//------------ Prototypes -----------//
+
+//--------- Implementation ----------//
+
+
+static int findSubscriber(const subscribers_t *s, const struct sockaddr_in *addr)
+{
+    uint32_t i;
+    for (i = 0; i < s->count; i++)
+    {
+        if ((s->addr[i].sin_addr.s_addr == addr->sin_addr.s_addr) && (s->addr[i].sin_port == addr->sin_port))
+            return i;
+    }
+    return -1;
+}
+
+
+static void removeAt(subscribers_t *s, uint32_t index)
+{
+    // Keep valid entries packed, so the table can be used as a destination list
+    s->count--;
+    s->addr[index] = s->addr[s->count];
+    s->lastSeen[index] = s->lastSeen[s->count];
+}
+
+
+/**
+    @brief  Init empty subscriber table
+    @param[out] s Table
+    @return None
+*/
+void subscribers_Init(subscribers_t *s)
+{
+    s->count = 0;
+}
+
+
+/**
+    @brief  Add subscriber or refresh existing one, called on hello datagram
+    @param[in]  s Table
+    @param[in]  addr Subscriber address and port
+    @param[in]  now Current time [us]
+    @return Result
+*/
+subscribersResult_t subscribers_Touch(subscribers_t *s, const struct sockaddr_in *addr, int64_t now)
+{
+    int index = findSubscriber(s, addr);
+    if (index >= 0)
+    {
+        s->lastSeen[index] = now;
+        return Subscribers_Refreshed;
+    }
+    if (s->count >= SUBSCRIBERS_MAX)
+        return Subscribers_TableFull;
+    s->addr[s->count] = *addr;
+    s->lastSeen[s->count] = now;
+    s->count++;
+    return Subscribers_Added;
+}
+
+
+/**
+    @brief  Remove subscriber, called on bye datagram
+    @param[in]  s Table
+    @param[in]  addr Subscriber address and port
+    @return True if subscriber was found
+*/
+bool subscribers_Remove(subscribers_t *s, const struct sockaddr_in *addr)
+{
+    int index = findSubscriber(s, addr);
+    if (index < 0)
+        return false;
+    removeAt(s, index);
+    return true;
+}
+
+
+/**
+    @brief  Remove subscribers without keepalive
+    @param[in]  s Table
+    @param[in]  now Current time [us]
+    @param[in]  timeout Keepalive timeout [us]
+    @return Number of removed subscribers
+*/
+uint32_t subscribers_Expire(subscribers_t *s, int64_t now, int64_t timeout)
+{
+    uint32_t expired = 0;
+    uint32_t i = 0;
+    while (i < s->count)
+    {
+        if (now - s->lastSeen[i] >= timeout)
+        {
+            removeAt(s, i);
+            expired++;
+        }
+        else
+        {
+            i++;
+        }
+    }
+    return expired;
+}
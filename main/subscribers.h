@@ -0,0 +1,55 @@
+/**
+    @file
+    @brief   Telemetry downlink subscriber table
+
+    Ground stations subscribe by sending TELEMETRY_HELLO_MAGIC to
+    TELEMETRY_PORT and repeat it as a keepalive. A subscriber expires when
+    no hello is received for TELEMETRY_SUBSCRIBER_TIMEOUT, or is removed at
+    once by TELEMETRY_BYE_MAGIC. Downlink datagrams go to the source
+    address and port of the hello.
+
+    The table is owned by telemetry_server_task, no locking is done.
+*/
+
+#ifndef __SUBSCRIBERS_H__
+#define __SUBSCRIBERS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "hal.h"
+#include "config.h"
+
+#define TELEMETRY_HELLO_MAGIC       "HELO"
+#define TELEMETRY_BYE_MAGIC         "BYE!"
+#define TELEMETRY_MAGIC_SIZE        4
+
+#define SUBSCRIBERS_MAX             TELEMETRY_MAX_SUBSCRIBERS
+
+typedef enum {
+    Subscribers_Refreshed,      // Known subscriber, expiry time is extended
+    Subscribers_Added,
+    Subscribers_TableFull,
+} subscribersResult_t;
+
+typedef struct {
+    struct sockaddr_in addr[SUBSCRIBERS_MAX];   // Destinations, first count entries are valid
+    int64_t lastSeen[SUBSCRIBERS_MAX];          // [us]
+    uint32_t count;
+} subscribers_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    void subscribers_Init(subscribers_t *s);
+    subscribersResult_t subscribers_Touch(subscribers_t *s, const struct sockaddr_in *addr, int64_t now);
+    bool subscribers_Remove(subscribers_t *s, const struct sockaddr_in *addr);
+    uint32_t subscribers_Expire(subscribers_t *s, int64_t now, int64_t timeout);
+
+#ifdef __cplusplus
+}   // extern "C"
+#endif
+
+#endif // __SUBSCRIBERS_H__
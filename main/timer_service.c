@@ -0,0 +1,213 @@
+/**
+    @file
+    @brief   Deadline timer service
+*/
+
+#include "hal.h"
+#include "timer_service.h"
+
+//------------ Definitions ----------//
+
+//------------ Variables ------------//
+
+static struct {
+    hal_Mutex_t mutex;
+    hal_Signal_t signal;                                // Earliest deadline has changed
+    timerService_Timer_t *heap[TIMER_SERVICE_MAX_TIMERS];
+    uint32_t count;
+} timers;
+
+//------------ Externals ------------//
+
+//------------ Prototypes -----------//
+
+//--------- Implementation ----------//
+
+
+static void heapPlace(uint32_t index, timerService_Timer_t *timer)
+{
+    timers.heap[index] = timer;
+    timer->heapIndex = index;
+}
+
+
+static void heapSiftUp(uint32_t index)
+{
+    timerService_Timer_t *timer = timers.heap[index];
+    while (index > 0)
+    {
+        uint32_t parent = (index - 1) / 2;
+        if (timers.heap[parent]->deadline <= timer->deadline)
+            break;
+        heapPlace(index, timers.heap[parent]);
+        index = parent;
+    }
+    heapPlace(index, timer);
+}
+
+
+static void heapSiftDown(uint32_t index)
+{
+    timerService_Timer_t *timer = timers.heap[index];
+    while (1)
+    {
+        uint32_t child = 2 * index + 1;
+        if (child >= timers.count)
+            break;
+        if ((child + 1 < timers.count) && (timers.heap[child + 1]->deadline < timers.heap[child]->deadline))
+            child++;
+        if (timer->deadline <= timers.heap[child]->deadline)
+            break;
+        heapPlace(index, timers.heap[child]);
+        index = child;
+    }
+    heapPlace(index, timer);
+}
+
+
+static void heapRemove(timerService_Timer_t *timer)
+{
+    uint32_t index = timer->heapIndex;
+    timer->heapIndex = -1;
+    timers.count--;
+    if (index == timers.count)
+        return;
+    // Move last timer into the hole and restore heap order in either direction
+    timerService_Timer_t *moved = timers.heap[timers.count];
+    heapPlace(index, moved);
+    heapSiftDown(index);
+    heapSiftUp(moved->heapIndex);
+}
+
+
+/**
+    @brief  Init timer service, must be called before any other function
+    @return None
+*/
+void timerService_Init(void)
+{
+    timers.mutex = hal_MutexCreate();
+    timers.signal = hal_SignalCreate();
+    timers.count = 0;
+}
+
+
+/**
+    @brief  Init timer structure, timer is not armed
+    @param[out] timer Timer
+    @param[in]  callback Function called from timer service context when deadline is reached
+    @param[in]  arg Argument of callback
+    @return None
+*/
+void timerService_InitTimer(timerService_Timer_t *timer, timerService_Callback_t callback, void *arg)
+{
+    timer->callback = callback;
+    timer->arg = arg;
+    timer->deadline = 0;
+    timer->heapIndex = -1;
+}
+
+
+/**
+    @brief  Arm timer or move deadline of armed timer
+    @param[in]  timer Timer
+    @param[in]  deadline Absolute time [us], see hal_GetTimeUs()
+    @return True if armed, false if TIMER_SERVICE_MAX_TIMERS timers are armed already
+*/
+bool timerService_Arm(timerService_Timer_t *timer, int64_t deadline)
+{
+    hal_MutexLock(timers.mutex);
+    if (timer->heapIndex >= 0)
+    {
+        heapRemove(timer);
+    }
+    else if (timers.count >= TIMER_SERVICE_MAX_TIMERS)
+    {
+        hal_MutexUnlock(timers.mutex);
+        return false;
+    }
+    timer->deadline = deadline;
+    heapPlace(timers.count++, timer);
+    heapSiftUp(timer->heapIndex);
+    bool isFirst = (timer->heapIndex == 0);
+    hal_MutexUnlock(timers.mutex);
+
+    // Timer service may sleep until a later deadline
+    if (isFirst)
+        hal_SignalGive(timers.signal);
+    return true;
+}
+
+
+/**
+    @brief  Arm timer relative to current time
+    @param[in]  timer Timer
+    @param[in]  delayMs Delay [ms]
+    @return True if armed
+*/
+bool timerService_ArmIn(timerService_Timer_t *timer, uint32_t delayMs)
+{
+    return timerService_Arm(timer, hal_GetTimeUs() + delayMs * 1000ll);
+}
+
+
+/**
+    @brief  Disarm timer, callback is not called
+            Callback that has already started is not waited for
+    @param[in]  timer Timer
+    @return None
+*/
+void timerService_Cancel(timerService_Timer_t *timer)
+{
+    hal_MutexLock(timers.mutex);
+    if (timer->heapIndex >= 0)
+        heapRemove(timer);
+    hal_MutexUnlock(timers.mutex);
+}
+
+
+/**
+    @brief  Check if timer is armed
+    @param[in]  timer Timer
+    @return True if deadline is pending
+*/
+bool timerService_IsArmed(const timerService_Timer_t *timer)
+{
+    hal_MutexLock(timers.mutex);
+    bool isArmed = (timer->heapIndex >= 0);
+    hal_MutexUnlock(timers.mutex);
+    return isArmed;
+}
+
+
+/**
+    @brief  Call expired timers and sleep until the next deadline
+    @return None, never returns
+*/
+void timerService_Run(void)
+{
+    while (1)
+    {
+        uint32_t waitMs = HAL_WAIT_FOREVER;
+
+        hal_MutexLock(timers.mutex);
+        while (timers.count > 0)
+        {
+            timerService_Timer_t *timer = timers.heap[0];
+            int64_t remaining = timer->deadline - hal_GetTimeUs();
+            if (remaining > 0)
+            {
+                // Rounded up, waking before the deadline would only cost another loop
+                waitMs = (uint32_t)((remaining + 999) / 1000);
+                break;
+            }
+            heapRemove(timer);
+            hal_MutexUnlock(timers.mutex);
+            timer->callback(timer->arg);
+            hal_MutexLock(timers.mutex);
+        }
+        hal_MutexUnlock(timers.mutex);
+
+        hal_SignalWait(timers.signal, waitMs);
+    }
+}
@@ -0,0 +1,49 @@
+/**
+    @file
+    @brief   Deadline timer service
+
+    One-shot timers on the monotonic clock (hal_GetTimeUs). Armed timers are
+    kept in a binary min-heap ordered by deadline; timerService_Run() sleeps
+    until the earliest deadline and calls expired callbacks in its own
+    context, so there are no periodic wakeups when no timer is due.
+
+    Timers can be armed and cancelled from any task. Callbacks must be short
+    and must not block; they may re-arm their own or other timers. The
+    timer structure is owned by the caller and must stay valid while armed.
+*/
+
+#ifndef __TIMER_SERVICE_H__
+#define __TIMER_SERVICE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TIMER_SERVICE_MAX_TIMERS    16      // Max number of simultaneously armed timers
+
+typedef void (*timerService_Callback_t)(void *arg);
+
+typedef struct {
+    timerService_Callback_t callback;
+    void *arg;
+    int64_t deadline;           // [us], valid while armed
+    int32_t heapIndex;          // -1 if not armed
+} timerService_Timer_t;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    void timerService_Init(void);
+    void timerService_Run(void);
+    void timerService_InitTimer(timerService_Timer_t *timer, timerService_Callback_t callback, void *arg);
+    bool timerService_Arm(timerService_Timer_t *timer, int64_t deadline);
+    bool timerService_ArmIn(timerService_Timer_t *timer, uint32_t delayMs);
+    void timerService_Cancel(timerService_Timer_t *timer);
+    bool timerService_IsArmed(const timerService_Timer_t *timer);
+
+#ifdef __cplusplus
+}   // extern "C"
+#endif
+
+#endif // __TIMER_SERVICE_H__
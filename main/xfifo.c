@@ -4,11 +4,20 @@
 	Data can be put in one thread and read in another without using
 	critical sections (same for interrupts).
 
+	Counters are C11 atomics: the producer publishes countWr with release
+	ordering after element data is written, the consumer publishes countRd
+	with release ordering after element data is read. Each side loads the
+	other side's counter with acquire ordering, so a consumer running on
+	another core never sees a count before the data it covers.
+
+	xFifo_PutMP() may be used by several producers at once. It takes the
+	FIFO put lock once per call (not per element).
 
 ******************************************************************************/
 
 #include "xfifo.h"
 #include <stdlib.h>
+#include <string.h>
 
 static void xFifo_CopyElement(uint8_t *src, uint8_t *dst, uint32_t size)
 {
@@ -20,14 +29,79 @@ static void xFifo_CopyElement(uint8_t *src, uint8_t *dst, uint32_t size)
 
 #define xFifo_NextIndex_M(f, index)     ((index == (f->size - 1)) ? 0 : index + 1)
 #define xFifo_PrevIndex_M(f, index)     ((index == 0) ? (f->size - 1) : index - 1)
+#define xFifo_WrapIndex_M(f, index)     ((index >= f->size) ? index - f->size : index)      // index < 2 * size
 #define xFifo_IncHeadIndex_M(f)         (f->headIndex = xFifo_NextIndex_M(f, f->headIndex))
 #define xFifo_DecHeadIndex_M(f)         (f->headIndex = xFifo_PrevIndex_M(f, f->headIndex))
 #define xFifo_IncTailIndex_M(f)         (f->tailIndex = xFifo_NextIndex_M(f, f->tailIndex))
 #define xFifo_DecTailIndex_M(f)         (f->tailIndex = xFifo_PrevIndex_M(f, f->tailIndex))
-#define xFifo_IsFull_M(f)               ((f->countWr - f->countRd) >= f->size)
-#define xFifo_IsNotFull_M(f)            ((f->countWr - f->countRd) < f->size)
-#define xFifo_IsEmpty_M(f)              (f->countWr == f->countRd)
-#define xFifo_IsNotEmpty_M(f)           (f->countWr != f->countRd)
+
+// Counter access. Own counter is loaded relaxed, opposite side counter with acquire
+#define xFifo_LoadWr_M(f, order)        atomic_load_explicit(&f->countWr, order)
+#define xFifo_LoadRd_M(f, order)        atomic_load_explicit(&f->countRd, order)
+#define xFifo_UsedByProducer_M(f)       (xFifo_LoadWr_M(f, memory_order_relaxed) - xFifo_LoadRd_M(f, memory_order_acquire))
+#define xFifo_UsedByConsumer_M(f)       (xFifo_LoadWr_M(f, memory_order_acquire) - xFifo_LoadRd_M(f, memory_order_relaxed))
+#define xFifo_PublishWr_M(f, count)     atomic_store_explicit(&f->countWr, xFifo_LoadWr_M(f, memory_order_relaxed) + (count), memory_order_release)
+#define xFifo_PublishRd_M(f, count)     atomic_store_explicit(&f->countRd, xFifo_LoadRd_M(f, memory_order_relaxed) + (count), memory_order_release)
+#define xFifo_IsNotFull_M(f)            (xFifo_UsedByProducer_M(f) < f->size)
+#define xFifo_IsNotEmpty_M(f)           (xFifo_UsedByConsumer_M(f) != 0)
+
+#ifdef ESP_PLATFORM
+#define xFifo_Lock_M(f)                 portENTER_CRITICAL_SAFE(&f->putLock)
+#define xFifo_Unlock_M(f)               portEXIT_CRITICAL_SAFE(&f->putLock)
+#else
+#define xFifo_Lock_M(f)                 while (atomic_flag_test_and_set_explicit(&f->putLock, memory_order_acquire)) {}
+#define xFifo_Unlock_M(f)               atomic_flag_clear_explicit(&f->putLock, memory_order_release)
+#endif
+
+
+//---------------------------------------------------------------------------//
+// Copy elements into the storage starting at given index
+// Request is split into at most two contiguous segments around the wrap point
+//
+//	Arguments:
+//		f - pointer to a xFifo_t structure
+//		index - storage index of the first element
+//		src - pointer to element(s)
+//		count - number of elements to copy, must not exceed f->size
+//	Return:
+//		storage index following the last copied element
+//---------------------------------------------------------------------------//
+static uint32_t xFifo_CopyIn(xFifo_t *f, uint32_t index, const uint8_t *src, uint32_t count)
+{
+	uint32_t firstCount = f->size - index;
+	if (firstCount > count)
+		firstCount = count;
+	memcpy(&f->data[index * f->elementSize], src, firstCount * f->elementSize);
+	if (count > firstCount)
+		memcpy(f->data, src + firstCount * f->elementSize, (count - firstCount) * f->elementSize);
+	index += count;
+	return xFifo_WrapIndex_M(f, index);
+}
+
+
+//---------------------------------------------------------------------------//
+// Copy elements from the storage starting at given index
+// Request is split into at most two contiguous segments around the wrap point
+//
+//	Arguments:
+//		f - pointer to a xFifo_t structure
+//		index - storage index of the first element
+//		dst - pointer to element(s)
+//		count - number of elements to copy, must not exceed f->size
+//	Return:
+//		storage index following the last copied element
+//---------------------------------------------------------------------------//
+static uint32_t xFifo_CopyOut(xFifo_t *f, uint32_t index, uint8_t *dst, uint32_t count)
+{
+	uint32_t firstCount = f->size - index;
+	if (firstCount > count)
+		firstCount = count;
+	memcpy(dst, &f->data[index * f->elementSize], firstCount * f->elementSize);
+	if (count > firstCount)
+		memcpy(dst + firstCount * f->elementSize, f->data, (count - firstCount) * f->elementSize);
+	index += count;
+	return xFifo_WrapIndex_M(f, index);
+}
 
 
 //---------------------------------------------------------------------------//
@@ -43,14 +117,7 @@ static void xFifo_CopyElement(uint8_t *src, uint8_t *dst, uint32_t size)
 //---------------------------------------------------------------------------//
 void xFifo_Create(xFifo_t *f, uint32_t elementSize, uint32_t fifoSize)
 {
-	f->data = (uint8_t *)malloc(elementSize * fifoSize);
-    if (!f->data) {}
-	f->size = fifoSize;
-	f->elementSize = elementSize;
-	f->headIndex = 0;
-	f->tailIndex = 0;
-	f->countRd = 0;
-	f->countWr = 0;
+	xFifo_CreateStatic(f, elementSize, (uint8_t *)malloc(elementSize * fifoSize), fifoSize);
 }
 
 
@@ -68,13 +135,19 @@ void xFifo_Create(xFifo_t *f, uint32_t elementSize, uint32_t fifoSize)
 //---------------------------------------------------------------------------//
 void xFifo_CreateStatic(xFifo_t *f, uint32_t elementSize, uint8_t *dataBuffer, uint32_t fifoSize)
 {
+#ifdef ESP_PLATFORM
+	portMUX_TYPE unlocked = portMUX_INITIALIZER_UNLOCKED;
+	f->putLock = unlocked;
+#else
+	atomic_flag_clear(&f->putLock);
+#endif
 	f->data = dataBuffer;
 	f->size = fifoSize;
 	f->elementSize = elementSize;
 	f->headIndex = 0;
 	f->tailIndex = 0;
-	f->countRd = 0;
-	f->countWr = 0;
+	atomic_init(&f->countRd, 0);
+	atomic_init(&f->countWr, 0);
 }
 
 
@@ -91,25 +164,45 @@ void xFifo_CreateStatic(xFifo_t *f, uint32_t elementSize, uint8_t *dataBuffer, u
 //---------------------------------------------------------------------------//
 uint32_t xFifo_Put(xFifo_t *f, void *data, uint32_t count)
 {
-	uint32_t elementsPut = 0;
-	uint8_t *inPtr = (uint8_t *)data;
-	uint32_t storageIndex;
-	while( (elementsPut < count) && (xFifo_IsNotFull_M(f)) )
-	{
-		storageIndex = f->headIndex * f->elementSize;
-		xFifo_CopyElement(inPtr, &f->data[storageIndex], f->elementSize);
-		inPtr += f->elementSize;
-        xFifo_IncHeadIndex_M(f);
-		f->countWr++;
-		elementsPut++;
-	}
+	uint32_t freeCount = f->size - xFifo_UsedByProducer_M(f);
+	if (count > freeCount)
+		count = freeCount;
+	if (count == 0)
+		return 0;
+	f->headIndex = xFifo_CopyIn(f, f->headIndex, (const uint8_t *)data, count);
+	xFifo_PublishWr_M(f, count);
+	return count;
+}
+
+
+//---------------------------------------------------------------------------//
+// Put data into xFifo from one of several concurrent producers
+// Same as xFifo_Put(), but takes the FIFO put lock for the duration of the call.
+// All producers of the FIFO must use this function.
+//
+//	Arguments:
+//		f - pointer to a xFifo_t structure to fill
+//		data - pointer to element(s)
+//		count - number of elements to put
+//	Return:
+//		number of elements actually put into xFifo
+//---------------------------------------------------------------------------//
+uint32_t xFifo_PutMP(xFifo_t *f, void *data, uint32_t count)
+{
+	uint32_t elementsPut;
+	xFifo_Lock_M(f);
+	elementsPut = xFifo_Put(f, data, count);
+	xFifo_Unlock_M(f);
 	return elementsPut;
 }
 
 
 //---------------------------------------------------------------------------//
 // Put data into xFifo (to the tail, reversed)
-// Data put by this function is first to be read from the FIFO
+// Data put by this function is first to be read from the FIFO, in the order
+// of data[]
+// Note: function touches consumer side of the FIFO, it must not be used
+// concurrently with producers or with reading
 //
 //	Arguments:
 //		f - pointer to a xFifo_t structure to fill
@@ -120,19 +213,15 @@ uint32_t xFifo_Put(xFifo_t *f, void *data, uint32_t count)
 //---------------------------------------------------------------------------//
 uint32_t xFifo_PutToTail(xFifo_t *f, void *data, uint32_t count)
 {
-	uint32_t elementsPut = 0;
-	uint8_t *inPtr = (uint8_t *)data;
-	uint32_t storageIndex;
-	while( (elementsPut < count) && (xFifo_IsNotFull_M(f)) )
-	{
-        xFifo_DecTailIndex_M(f);
-		storageIndex = f->tailIndex * f->elementSize;
-		xFifo_CopyElement(inPtr, &f->data[storageIndex], f->elementSize);
-		inPtr += f->elementSize;
-		f->countWr++;
-		elementsPut++;
-	}
-	return elementsPut;
+	uint32_t freeCount = f->size - xFifo_UsedByProducer_M(f);
+	if (count > freeCount)
+		count = freeCount;
+	if (count == 0)
+		return 0;
+	f->tailIndex = xFifo_WrapIndex_M(f, f->tailIndex + f->size - count);
+	xFifo_CopyIn(f, f->tailIndex, (const uint8_t *)data, count);
+	atomic_fetch_add_explicit(&f->countWr, count, memory_order_release);
+	return count;
 }
 
 
@@ -176,41 +265,93 @@ uint32_t xFifo_AcceptInsert(xFifo_t *f)
     if (xFifo_IsNotFull_M(f))
     {
         xFifo_IncHeadIndex_M(f);
-        f->countWr++;
+        xFifo_PublishWr_M(f, 1);
         elementsPut++;
     }
     return elementsPut;
 }
 
 
+//---------------------------------------------------------------------------//
+// Fill spans with up to two contiguous free regions of the xFifo
+// Free space is returned in order: data must be written to spans[0] first.
+// May be used to receive data directly into the FIFO storage.
+// Note: there should be single place using Insert() and Write functions
+//
+//	Arguments:
+//		f - pointer to a xFifo_t structure
+//		spans - array of two spans to fill. Unused span has count = 0
+//	Return:
+//		total number of free elements in both spans
+//---------------------------------------------------------------------------//
+uint32_t xFifo_GetWriteSpans(xFifo_t *f, xFifo_Span_t spans[2])
+{
+	uint32_t freeCount = f->size - xFifo_UsedByProducer_M(f);
+	uint32_t firstCount = f->size - f->headIndex;
+	if (firstCount > freeCount)
+		firstCount = freeCount;
+	spans[0].ptr = &f->data[f->headIndex * f->elementSize];
+	spans[0].count = firstCount;
+	spans[1].ptr = f->data;
+	spans[1].count = freeCount - firstCount;
+	return freeCount;
+}
+
+
+//---------------------------------------------------------------------------//
+// Make elements written into spans returned by xFifo_GetWriteSpans() avaliable
+// to the consumer
+// Note: there should be single place using Insert() and Write functions
+//
+//	Arguments:
+//		f - pointer to a xFifo_t structure
+//		count - number of elements written
+//	Return:
+//		number of elements actually put into xFifo
+//---------------------------------------------------------------------------//
+uint32_t xFifo_CommitWrite(xFifo_t *f, uint32_t count)
+{
+	uint32_t freeCount = f->size - xFifo_UsedByProducer_M(f);
+	if (count > freeCount)
+		count = freeCount;
+	f->headIndex += count;
+	if (f->headIndex >= f->size)
+		f->headIndex -= f->size;
+	xFifo_PublishWr_M(f, count);
+	return count;
+}
+
+
 //---------------------------------------------------------------------------//
 // Get data from xFifo
 //
 //	Arguments:
 //		f - pointer to a xFifo_t structure
-//		data - pointer to element(s)
+//		data - pointer to element(s), may be NULL to discard elements
 //		count - number of elements to get
 //	Return:
 //		number of elements actually got from xFifo
 //---------------------------------------------------------------------------//
 uint32_t xFifo_Get(xFifo_t *f, void *data, uint32_t count)
 {
-	uint32_t elementsGot = 0;
-	uint8_t *outPtr = (uint8_t *)data;
-	uint32_t storageIndex;
-	while ((elementsGot < count) && (xFifo_IsNotEmpty_M(f)))
+	uint32_t availCount = xFifo_UsedByConsumer_M(f);
+	if (count > availCount)
+		count = availCount;
+	if (count == 0)
+		return 0;
+	if (data)
 	{
-		storageIndex = f->tailIndex * f->elementSize;
-        if (outPtr)
-        {
-            xFifo_CopyElement(&f->data[storageIndex], outPtr, f->elementSize);
-            outPtr += f->elementSize;
-        }
-        xFifo_IncTailIndex_M(f);
-		f->countRd++;
-		elementsGot++;
+		f->tailIndex = xFifo_CopyOut(f, f->tailIndex, (uint8_t *)data, count);
 	}
-	return elementsGot;
+	else
+	{
+		// Discard elements
+		f->tailIndex += count;
+		if (f->tailIndex >= f->size)
+			f->tailIndex -= f->size;
+	}
+	xFifo_PublishRd_M(f, count);
+	return count;
 }
 
 
@@ -266,6 +407,7 @@ uint32_t xFifo_Peek(xFifo_t *f, void *data)
 
 //---------------------------------------------------------------------------//
 // Peek data from xFifo at specified position (rd counter is not affected)
+// Storage index is computed directly, cost does not depend on the position
 // Note: there should be single place using Peek() functions
 //
 //  Arguments:
@@ -277,24 +419,38 @@ uint32_t xFifo_Peek(xFifo_t *f, void *data)
 //---------------------------------------------------------------------------//
 uint32_t xFifo_PeekAt(xFifo_t *f, void *data, uint32_t elementIndex)
 {
-    uint32_t elementsGot = 0;
-    uint8_t *outPtr = (uint8_t *)data;
     uint32_t storageIndex;
-    uint32_t countRd = f->countRd;
-    uint32_t tailIndex = f->tailIndex;
-    while (f->countWr != countRd)
-    {
-        if (elementIndex == elementsGot)
-        {
-            storageIndex = tailIndex * f->elementSize;
-            xFifo_CopyElement(&f->data[storageIndex], outPtr, f->elementSize);
-            return 1;
-        }
-        tailIndex = xFifo_NextIndex_M(f, tailIndex);
-		countRd++;
-		elementsGot++;
-    }
-    return 0;
+    if (elementIndex >= xFifo_UsedByConsumer_M(f))
+        return 0;
+    storageIndex = xFifo_WrapIndex_M(f, f->tailIndex + elementIndex);
+    memcpy(data, &f->data[storageIndex * f->elementSize], f->elementSize);
+    return 1;
+}
+
+
+//---------------------------------------------------------------------------//
+// Peek a range of elements from xFifo (rd counter is not affected)
+// Range is copied with at most two block copies around the wrap point
+// Note: there should be single place using Peek() functions
+//
+//  Arguments:
+//      f - pointer to a xFifo_t structure
+//      data - pointer to element(s)
+//      elementIndex - index of the first element to peek, 0 = tail
+//      count - number of elements to peek
+//  Return:
+//      number of elements actually copied, less than count if the range
+//      extends past the newest element
+//---------------------------------------------------------------------------//
+uint32_t xFifo_PeekRange(xFifo_t *f, void *data, uint32_t elementIndex, uint32_t count)
+{
+    uint32_t availCount = xFifo_UsedByConsumer_M(f);
+    if (elementIndex >= availCount)
+        return 0;
+    if (count > availCount - elementIndex)
+        count = availCount - elementIndex;
+    xFifo_CopyOut(f, xFifo_WrapIndex_M(f, f->tailIndex + elementIndex), (uint8_t *)data, count);
+    return count;
 }
 
 
@@ -312,13 +468,56 @@ void xFifo_AcceptPeek(xFifo_t *f)
     if (xFifo_IsNotEmpty_M(f))
     {
         xFifo_IncTailIndex_M(f);
-        f->countRd++;
+        xFifo_PublishRd_M(f, 1);
     }
 }
 
 
+//---------------------------------------------------------------------------//
+// Fill spans with up to two contiguous regions of avaliable data of the xFifo
+// Data is returned in order: spans[0] holds the oldest elements.
+// May be used to send data directly from the FIFO storage.
+// Note: there should be single place using Peek() and Read functions
+//
+//	Arguments:
+//		f - pointer to a xFifo_t structure
+//		spans - array of two spans to fill. Unused span has count = 0
+//	Return:
+//		total number of avaliable elements in both spans
+//---------------------------------------------------------------------------//
+uint32_t xFifo_GetReadSpans(xFifo_t *f, xFifo_Span_t spans[2])
+{
+	uint32_t availCount = xFifo_UsedByConsumer_M(f);
+	uint32_t firstCount = f->size - f->tailIndex;
+	if (firstCount > availCount)
+		firstCount = availCount;
+	spans[0].ptr = &f->data[f->tailIndex * f->elementSize];
+	spans[0].count = firstCount;
+	spans[1].ptr = f->data;
+	spans[1].count = availCount - firstCount;
+	return availCount;
+}
+
+
+//---------------------------------------------------------------------------//
+// Release elements read from spans returned by xFifo_GetReadSpans()
+// Note: there should be single place using Peek() and Read functions
+//
+//	Arguments:
+//		f - pointer to a xFifo_t structure
+//		count - number of elements consumed
+//	Return:
+//		number of elements actually removed from xFifo
+//---------------------------------------------------------------------------//
+uint32_t xFifo_CommitRead(xFifo_t *f, uint32_t count)
+{
+	return xFifo_Get(f, 0, count);
+}
+
+
 //---------------------------------------------------------------------------//
 // Clear xFifo
+// Must be called from the consumer side, all available elements are discarded
 //
 //	Arguments:
 //		f - pointer to a xFifo_t structure to fill
@@ -327,8 +526,7 @@ void xFifo_AcceptPeek(xFifo_t *f)
 //---------------------------------------------------------------------------//
 void xFifo_Clear(xFifo_t *f)
 {
-	f->countRd = f->countWr;
-	f->tailIndex = f->headIndex;
+	xFifo_Get(f, 0, xFifo_UsedByConsumer_M(f));
 }
 
 
@@ -342,7 +540,7 @@ void xFifo_Clear(xFifo_t *f)
 //---------------------------------------------------------------------------//
 uint32_t xFifo_DataAvaliable(xFifo_t *f)
 {
-    return f->countWr - f->countRd;
+    return xFifo_LoadWr_M(f, memory_order_acquire) - xFifo_LoadRd_M(f, memory_order_acquire);
 }
 
 
@@ -356,7 +554,7 @@ uint32_t xFifo_DataAvaliable(xFifo_t *f)
 //---------------------------------------------------------------------------//
 uint32_t xFifo_FreeSpace(xFifo_t *f)
 {
-	return f->size - (f->countWr - f->countRd);
+	return f->size - (xFifo_LoadWr_M(f, memory_order_acquire) - xFifo_LoadRd_M(f, memory_order_acquire));
 }
 
 
@@ -5,24 +5,46 @@
 	critical sections (same for interrupts).
 
 	If, however, data is put into the same xFifo from different threads,
-	then critical sections are required.
+	then all of them must use xFifo_PutMP().
+
+	Producer fields (headIndex, countWr) and consumer fields (tailIndex,
+	countRd) are placed in separate cache lines.
 
 ******************************************************************************/
 #ifndef __XFIFO_H__
 #define __XFIFO_H__
 
 #include <stdint.h>
+#include <stdatomic.h>
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+typedef portMUX_TYPE xFifo_Lock_t;
+#define XFIFO_CACHE_LINE_SIZE       32
+#else
+typedef atomic_flag xFifo_Lock_t;
+#define XFIFO_CACHE_LINE_SIZE       64
+#endif
 
 typedef struct {
 	uint8_t *data;
 	uint32_t elementSize;
 	uint32_t size;
-	uint32_t headIndex;
-	uint32_t tailIndex;
-	uint32_t countWr;			// operations with this type must be atomic!
-	uint32_t countRd;
+	// Producer side
+	_Alignas(XFIFO_CACHE_LINE_SIZE) uint32_t headIndex;
+	_Atomic uint32_t countWr;
+	xFifo_Lock_t putLock;		// used by xFifo_PutMP() only
+	// Consumer side
+	_Alignas(XFIFO_CACHE_LINE_SIZE) uint32_t tailIndex;
+	_Atomic uint32_t countRd;
 } xFifo_t;
 
+// Contiguous region of FIFO storage
+typedef struct {
+	void *ptr;
+	uint32_t count;				// number of elements
+} xFifo_Span_t;
+
 
 #ifdef __cplusplus
 extern "C"
@@ -32,14 +54,20 @@ extern "C"
 	void xFifo_Create(xFifo_t *f, uint32_t elementSize, uint32_t fifoSize);
 	void xFifo_CreateStatic(xFifo_t *f, uint32_t elementSize, uint8_t *dataBuffer, uint32_t fifoSize);
 	uint32_t xFifo_Put(xFifo_t *f, void *data, uint32_t count);
+	uint32_t xFifo_PutMP(xFifo_t *f, void *data, uint32_t count);
     uint32_t xFifo_PutToTail(xFifo_t *f, void *data, uint32_t count);
     void *xFifo_GetInsertPtr(xFifo_t *f);
     uint32_t xFifo_AcceptInsert(xFifo_t *f);
+    uint32_t xFifo_GetWriteSpans(xFifo_t *f, xFifo_Span_t spans[2]);
+    uint32_t xFifo_CommitWrite(xFifo_t *f, uint32_t count);
 	uint32_t xFifo_Get(xFifo_t *f, void *data, uint32_t count);
     void *xFifo_GetPeekPtr(xFifo_t *f);
 	uint32_t xFifo_Peek(xFifo_t *f, void *data);
     void xFifo_AcceptPeek(xFifo_t *f);
-    uint32_t xFifo_PeekAt(xFifo_t *f, void *data, uint32_t elementOffset);
+    uint32_t xFifo_GetReadSpans(xFifo_t *f, xFifo_Span_t spans[2]);
+    uint32_t xFifo_CommitRead(xFifo_t *f, uint32_t count);
+    uint32_t xFifo_PeekAt(xFifo_t *f, void *data, uint32_t elementIndex);
+    uint32_t xFifo_PeekRange(xFifo_t *f, void *data, uint32_t elementIndex, uint32_t count);
 	void xFifo_Clear(xFifo_t *f);
 	uint32_t xFifo_DataAvaliable(xFifo_t *f);
 	uint32_t xFifo_FreeSpace(xFifo_t *f);
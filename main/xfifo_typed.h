@@ -0,0 +1,161 @@
+/******************************************************************************
+	Typed FIFO generator
+
+	Header-only counterpart of xFifo with element type and capacity fixed
+	at compile time. XFIFO_TYPED_DEFINE(name, type, capacity) generates
+	name_t (storage is a member array, so an instance is statically
+	allocated wherever it is declared), constant name_Capacity and a set
+	of static inline functions:
+
+		name_Init, name_Put, name_PutOne, name_Get, name_GetOne,
+		name_Clear, name_DataAvaliable, name_FreeSpace
+
+	There are no runtime element size multiplications. Indices wrap with
+	a mask when capacity is a power of two, with a single compare
+	otherwise.
+
+	Thread-safety rules are the same as for xFifo: one producer thread
+	and one consumer thread may use the FIFO without critical sections.
+	As in xFifo, the producer publishes countWr with release after the
+	elements are written and the consumer loads it with acquire before
+	reading them (countRd the other way round), so the elements are
+	visible on the other core before the count is.
+
+	Usage:
+		XFIFO_TYPED_DEFINE(byteFifo, uint8_t, 2048)
+		static byteFifo_t downlinkFifo;
+		...
+		byteFifo_Init(&downlinkFifo);
+		byteFifo_Put(&downlinkFifo, buffer, len);
+
+******************************************************************************/
+#ifndef __XFIFO_TYPED_H__
+#define __XFIFO_TYPED_H__
+
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#define XFIFO_TYPED_IS_POW2(n)          (((n) & ((n) - 1)) == 0)
+
+#define XFIFO_TYPED_DEFINE(name, type, capacity)                                            \
+                                                                                            \
+_Static_assert((capacity) > 0, #name ": capacity must be non-zero");                        \
+                                                                                            \
+enum { name##_Capacity = (capacity) };                                                      \
+                                                                                            \
+typedef struct {                                                                            \
+    type data[capacity];                                                                    \
+    uint32_t headIndex;                                                                     \
+    uint32_t tailIndex;                                                                     \
+    _Atomic uint32_t countWr;                                                               \
+    _Atomic uint32_t countRd;                                                               \
+} name##_t;                                                                                 \
+                                                                                            \
+static inline uint32_t name##_Wrap(uint32_t index)                                          \
+{                                                                                           \
+    if (XFIFO_TYPED_IS_POW2(capacity))                                                      \
+        return index & ((capacity) - 1);                                                    \
+    return (index >= (capacity)) ? index - (capacity) : index;                              \
+}                                                                                           \
+                                                                                            \
+static inline void name##_Init(name##_t *f)                                                 \
+{                                                                                           \
+    f->headIndex = 0;                                                                       \
+    f->tailIndex = 0;                                                                       \
+    atomic_init(&f->countWr, 0);                                                            \
+    atomic_init(&f->countRd, 0);                                                            \
+}                                                                                           \
+                                                                                            \
+/* Consumer side: elements counted by countWr are visible after the acquire load */         \
+static inline uint32_t name##_DataAvaliable(name##_t *f)                                    \
+{                                                                                           \
+    return atomic_load_explicit(&f->countWr, memory_order_acquire) -                        \
+           atomic_load_explicit(&f->countRd, memory_order_relaxed);                         \
+}                                                                                           \
+                                                                                            \
+/* Producer side: slots counted by countRd are no longer read after the acquire load */     \
+static inline uint32_t name##_FreeSpace(name##_t *f)                                        \
+{                                                                                           \
+    return (capacity) - (atomic_load_explicit(&f->countWr, memory_order_relaxed) -          \
+                         atomic_load_explicit(&f->countRd, memory_order_acquire));          \
+}                                                                                           \
+                                                                                            \
+static inline void name##_PublishWr(name##_t *f, uint32_t count)                            \
+{                                                                                           \
+    uint32_t total = atomic_load_explicit(&f->countWr, memory_order_relaxed) + count;       \
+    atomic_store_explicit(&f->countWr, total, memory_order_release);                        \
+}                                                                                           \
+                                                                                            \
+static inline void name##_PublishRd(name##_t *f, uint32_t count)                            \
+{                                                                                           \
+    uint32_t total = atomic_load_explicit(&f->countRd, memory_order_relaxed) + count;       \
+    atomic_store_explicit(&f->countRd, total, memory_order_release);                        \
+}                                                                                           \
+                                                                                            \
+static inline uint32_t name##_Put(name##_t *f, const type *data, uint32_t count)            \
+{                                                                                           \
+    uint32_t freeCount = name##_FreeSpace(f);                                               \
+    uint32_t firstCount;                                                                    \
+    if (count > freeCount)                                                                  \
+        count = freeCount;                                                                  \
+    firstCount = (capacity) - f->headIndex;                                                 \
+    if (firstCount > count)                                                                 \
+        firstCount = count;                                                                 \
+    memcpy(&f->data[f->headIndex], data, firstCount * sizeof(type));                        \
+    if (count > firstCount)                                                                 \
+        memcpy(&f->data[0], data + firstCount, (count - firstCount) * sizeof(type));        \
+    f->headIndex = name##_Wrap(f->headIndex + count);                                       \
+    name##_PublishWr(f, count);                                                             \
+    return count;                                                                           \
+}                                                                                           \
+                                                                                            \
+static inline uint32_t name##_PutOne(name##_t *f, const type *element)                      \
+{                                                                                           \
+    if (name##_FreeSpace(f) == 0)                                                           \
+        return 0;                                                                           \
+    f->data[f->headIndex] = *element;                                                       \
+    f->headIndex = name##_Wrap(f->headIndex + 1);                                           \
+    name##_PublishWr(f, 1);                                                                 \
+    return 1;                                                                               \
+}                                                                                           \
+                                                                                            \
+static inline uint32_t name##_Get(name##_t *f, type *data, uint32_t count)                  \
+{                                                                                           \
+    uint32_t availCount = name##_DataAvaliable(f);                                          \
+    uint32_t firstCount;                                                                    \
+    if (count > availCount)                                                                 \
+        count = availCount;                                                                 \
+    if (data)                                                                               \
+    {                                                                                       \
+        firstCount = (capacity) - f->tailIndex;                                             \
+        if (firstCount > count)                                                             \
+            firstCount = count;                                                             \
+        memcpy(data, &f->data[f->tailIndex], firstCount * sizeof(type));                    \
+        if (count > firstCount)                                                             \
+            memcpy(data + firstCount, &f->data[0], (count - firstCount) * sizeof(type));    \
+    }                                                                                       \
+    f->tailIndex = name##_Wrap(f->tailIndex + count);                                       \
+    name##_PublishRd(f, count);                                                             \
+    return count;                                                                           \
+}                                                                                           \
+                                                                                            \
+static inline uint32_t name##_GetOne(name##_t *f, type *element)                            \
+{                                                                                           \
+    if (name##_DataAvaliable(f) == 0)                                                       \
+        return 0;                                                                           \
+    *element = f->data[f->tailIndex];                                                       \
+    f->tailIndex = name##_Wrap(f->tailIndex + 1);                                           \
+    name##_PublishRd(f, 1);                                                                 \
+    return 1;                                                                               \
+}                                                                                           \
+                                                                                            \
+/* Consumer side: drops the published elements, headIndex of the producer is not read */   \
+static inline void name##_Clear(name##_t *f)                                                \
+{                                                                                           \
+    uint32_t count = name##_DataAvaliable(f);                                               \
+    f->tailIndex = name##_Wrap(f->tailIndex + count);                                       \
+    name##_PublishRd(f, count);                                                             \
+}
+
+#endif //__XFIFO_TYPED_H__